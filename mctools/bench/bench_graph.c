@@ -0,0 +1,176 @@
+/*===============================================================================================
+ *  bench_graph.c
+ *
+ *  Generates the synthetic graphs of the benchmark suite (see run.sh): uniform random simple
+ *  graphs of a given number of nodes and edges, without self-loops or multiple edges, written as
+ *  text edge lists (see mcgraph.h). The graphs only depend on the arguments, a splitmix64 stream
+ *  seeded by SEED is used in place of the C library generator so they are the same on every
+ *  system.
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  To compile use the following command (igraph is not needed):
+ *
+ *     gcc -O3 bench_graph.c -o bench_graph
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Usage:
+ *
+ *     bench_graph NODES EDGES SEED GRAPH_OUT [--undirected]
+ *
+ *     NODES        - Number of nodes (at least 2)
+ *     EDGES        - Number of edges (at most the number of possible edges)
+ *     SEED         - Seed of the random stream
+ *     GRAPH_OUT    - File to write the edge list to
+ *     --undirected - Only one edge is placed between a pair of nodes (default directed)
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Function prototypes */
+unsigned long long next_random (unsigned long long *state);
+int compare_edges (const void *a, const void *b);
+void print_usage (void);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Main function */
+int main (int argc, const char * argv[])
+{
+	unsigned long long state, *edges, u, v, nodes;
+	long int count, have, e, i, held;
+	double possible;
+	const char *args[4];
+	int a, positional, directed;
+	FILE *out;
+
+	if (argc == 2 && strcmp(argv[1], "-h") == 0) {
+		print_usage();
+		return 0;
+	}
+
+	/* Separate the options from the positional arguments */
+	directed = 1;
+	positional = 0;
+	for (a=1; a<argc; a++) {
+		if (strcmp(argv[a], "--undirected") == 0) {
+			directed = 0;
+		}
+		else if (positional < 4) {
+			args[positional++] = argv[a];
+		}
+		else {
+			positional++;
+		}
+	}
+	if (positional != 4) {
+		printf("Invalid number of arguments.\n");
+		return 1;
+	}
+	nodes = strtoull(args[0], NULL, 10);
+	count = atol(args[1]);
+	state = strtoull(args[2], NULL, 10);
+	possible = (double)nodes*(double)(nodes - 1)/((directed != 0) ? 1.0 : 2.0);
+	if (nodes < 2 || count < 0 || (double)count > possible) {
+		printf("Invalid number of nodes or edges.\n");
+		return 1;
+	}
+
+	/* Draw edges (as u*nodes + v) until enough distinct ones are held, duplicates being removed
+	   after each round by sorting */
+	edges = (unsigned long long *)malloc(sizeof(unsigned long long)*(count + 1));
+	if (edges == NULL) {
+		printf("Not enough memory for the edges.\n");
+		return 1;
+	}
+	have = 0;
+	while (have < count) {
+		for (e=have; e<count; e++) {
+			do {
+				u = next_random(&state) % nodes;
+				v = next_random(&state) % nodes;
+			} while (u == v);
+			if (directed == 0 && u > v) {
+				edges[e] = v*nodes + u;
+			}
+			else {
+				edges[e] = u*nodes + v;
+			}
+		}
+		qsort(edges, (size_t)count, sizeof(unsigned long long), compare_edges);
+		held = 0;
+		for (i=0; i<count; i++) {
+			if (held == 0 || edges[i] != edges[held-1]) {
+				edges[held++] = edges[i];
+			}
+		}
+		have = held;
+	}
+
+	/* Write the edge list */
+	out = fopen(args[3], "w");
+	if (out == NULL) {
+		printf("Could not write graph to %s.\n", args[3]);
+		free(edges);
+		return 1;
+	}
+	fprintf(out, "# bench_graph %s %s %s%s\n", args[0], args[1], args[2],
+			  (directed != 0) ? "" : " --undirected");
+	for (e=0; e<count; e++) {
+		fprintf(out, "%llu\t%llu\n", edges[e] / nodes, edges[e] % nodes);
+	}
+	fclose(out);
+	free(edges);
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Next value of a splitmix64 stream */
+unsigned long long next_random (unsigned long long *state)
+{
+	unsigned long long z;
+
+	*state += 0x9E3779B97F4A7C15ULL;
+	z = *state;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Order of the edges for sorting */
+int compare_edges (const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+
+	return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void print_usage (void)
+{
+	printf("bench_graph NODES EDGES SEED GRAPH_OUT [--undirected]\n");
+	printf("  NODES        - Number of nodes\n");
+	printf("  EDGES        - Number of edges\n");
+	printf("  SEED         - Seed of the random stream\n");
+	printf("  GRAPH_OUT    - File to write the edge list to\n");
+	printf("  --undirected - Only one edge is placed between a pair of nodes (default directed)\n");
+}
+
+/* ---------------------------------------------------------------------------------------------- */
@@ -0,0 +1,245 @@
+#!/bin/sh
+#=================================================================================================
+#  run.sh
+#
+#  Benchmark suite of the mctools command line applications. Runs mcc, mcstats and mcextract with
+#  fixed seeds over the graphs of docs/graphs, the test graphs and synthetic random graphs of
+#  increasing size and density (from bench_graph.c) for several motifs of 3 and 4 nodes. The wall
+#  time, peak memory and throughput of every run are taken from its --metrics report (see
+#  mcmetrics.h) and written to WORK_DIR/results.csv, which is compared with a stored baseline:
+#
+#     tool,graph,size,motif,wall_seconds,peak_rss_kb,instances,instances_per_second,samples,
+#     samples_per_second
+#
+#  Instances per second are the unique motif instances found over the wall time of the motifs
+#  phase, samples per second the random samples of mcc over the wall time of its samples phase.
+#
+#------------------------------------------------------------------------------------------------
+#
+#  Usage:
+#
+#     bench/run.sh [--bin DIR] [--work DIR] [--baseline FILE] [--save-baseline] [--quick]
+#                  [--threads N] [--samples N] [--repeat N] [--tolerance T] [--min-time S]
+#
+#     --bin DIR       - Directory holding the compiled tools (default the mctools directory)
+#     --work DIR      - Directory for the generated graphs, reports and results (default
+#                       bench/work)
+#     --baseline FILE - Results to compare with (default bench/baseline.csv), runs that are more
+#                       than T times slower are reported as regressions and make the exit status 1
+#     --save-baseline - Store the results as the baseline instead of comparing with it
+#     --quick         - Only the small synthetic graphs
+#     --threads N     - Threads used by mcc and mcstats (default 1)
+#     --samples N     - Random samples of each mcc run (default 10)
+#     --repeat N      - Runs of each case, the fastest is kept (default 3)
+#     --tolerance T   - Slowdown reported as a regression (default 1.25)
+#     --min-time S    - Cases faster than S seconds in the baseline are not compared, their
+#                       times are mostly noise (default 0.05)
+#
+#  Baselines are only meaningful on the machine (and build) they were recorded on, so none is
+#  shipped: record one with --save-baseline before making changes.
+#
+#------------------------------------------------------------------------------------------------
+#
+#  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+#
+#  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+#  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+#  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#=================================================================================================
+
+BENCH=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$BENCH/../.." && pwd)
+BIN="$BENCH/.."
+WORK="$BENCH/work"
+BASELINE="$BENCH/baseline.csv"
+SAVE=0
+QUICK=0
+THREADS=1
+SAMPLES=10
+REPEAT=3
+TOLERANCE=1.25
+MIN_TIME=0.05
+SEED=1
+TRIALS=200
+
+while [ $# -gt 0 ]; do
+	case "$1" in
+		--bin) BIN="$2"; shift ;;
+		--work) WORK="$2"; shift ;;
+		--baseline) BASELINE="$2"; shift ;;
+		--save-baseline) SAVE=1 ;;
+		--quick) QUICK=1 ;;
+		--threads) THREADS="$2"; shift ;;
+		--samples) SAMPLES="$2"; shift ;;
+		--repeat) REPEAT="$2"; shift ;;
+		--tolerance) TOLERANCE="$2"; shift ;;
+		--min-time) MIN_TIME="$2"; shift ;;
+		-h) sed -n '/^#  Usage:/,/^#  Baselines/p' "$0" | sed 's/^#//'; exit 0 ;;
+		*) echo "Unknown option $1."; exit 1 ;;
+	esac
+	shift
+done
+
+for tool in mcc mcstats mcextract; do
+	if [ ! -x "$BIN/$tool" ]; then
+		echo "Could not find $BIN/$tool, compile the tools first (see README.md)."
+		exit 1
+	fi
+done
+mkdir -p "$WORK/graphs" "$WORK/runs" || exit 1
+
+# ------------------------------------------------------------------------------------------------
+
+# Synthetic graphs from the fixed seed: NAME NODES EDGES [--undirected], growing in size at an
+# average degree of 2 and in density at a fixed size
+if [ ! -x "$WORK/bench_graph" ] || [ "$BENCH/bench_graph.c" -nt "$WORK/bench_graph" ]; then
+	${CC:-gcc} -O3 "$BENCH/bench_graph.c" -o "$WORK/bench_graph" || exit 1
+fi
+SYNTHETIC="rand-1k-d2 1000 2000
+rand-4k-d2 4000 8000
+rand-1k-d4 1000 4000
+rand-1k-u2 1000 1000 --undirected
+rand-1k-u4 1000 2000 --undirected"
+if [ $QUICK -eq 0 ]; then
+	SYNTHETIC="$SYNTHETIC
+rand-16k-d2 16000 32000
+rand-4k-d4 4000 16000
+rand-4k-d8 4000 32000
+rand-4k-u4 4000 8000 --undirected
+rand-16k-u4 16000 32000 --undirected"
+fi
+echo "$SYNTHETIC" | while read -r name nodes edges flag; do
+	if [ ! -f "$WORK/graphs/$name.txt" ]; then
+		"$WORK/bench_graph" $nodes $edges $SEED "$WORK/graphs/$name.txt" $flag || exit 1
+	fi
+done
+
+# Graphs of the suite: FILE and whether it is directed (the motifs differ)
+GRAPHS="$ROOT/docs/graphs/transcriptional-ecoli.gml d
+$ROOT/docs/graphs/transcriptional-yeast.gml d
+$ROOT/docs/graphs/foodweb-littlerock.gml d
+$BENCH/../tests/test_D_1.gml d
+$BENCH/../tests/test_U_1.gml u"
+for name in $(echo "$SYNTHETIC" | cut -d' ' -f1); do
+	case "$name" in
+		*-u*) GRAPHS="$GRAPHS
+$WORK/graphs/$name.txt u --undirected" ;;
+		*) GRAPHS="$GRAPHS
+$WORK/graphs/$name.txt d" ;;
+	esac
+done
+
+# Motifs (SIZE ID) of directed and undirected graphs
+MOTIFS_D="3 7
+3 11
+4 14
+4 20"
+MOTIFS_U="3 2
+3 3
+4 6
+4 10"
+
+# ------------------------------------------------------------------------------------------------
+
+# Value of a key of a report, the first one found or the one of a phase (the reports of
+# mcmetrics.c hold one phase or counter per line)
+metric () {
+	awk -v key="$2" -v section="$3" '
+		BEGIN { found = "" }
+		found == "" && (section == "" || index($0, "\"" section "\": {") > 0) &&
+		match($0, "\"" key "\": [0-9.e+-]+") { found = substr($0, RSTART, RLENGTH) }
+		END { sub(/.*: /, "", found); print (found == "") ? 0 : found }' "$1"
+}
+
+RESULTS="$WORK/results.csv"
+echo "tool,graph,size,motif,wall_seconds,peak_rss_kb,instances,instances_per_second,samples,samples_per_second" > "$RESULTS"
+
+# Run a tool REPEAT times and add the line of its fastest run to the results: TOOL GRAPH SIZE
+# MOTIF REPORT COUNTS COMMAND... The instances of the graph are read from the report COUNTS, or
+# REPORT if it is missing: mcc takes those of mcstats, so its throughput over the motifs phase
+# (which only covers the graph) never counts the instances of the samples
+record () {
+	tool=$1; graph=$2; size=$3; motif=$4; report=$5; counts=$6; shift 6
+	rm -f "$report.best"
+	run=0
+	while [ $run -lt $REPEAT ]; do
+		rm -f "$report"
+		if ! "$@" > "$report.out" 2>&1 || [ ! -f "$report" ]; then
+			echo "  $tool $graph $size $motif failed, see $report.out"
+			rm -f "$report"
+			return
+		fi
+		if [ ! -f "$report.best" ] || awk -v a="$(metric "$report" wall_seconds)" \
+				-v b="$(metric "$report.best" wall_seconds)" 'BEGIN { exit (a < b) ? 0 : 1 }'; then
+			mv "$report" "$report.best"
+		fi
+		run=$((run + 1))
+	done
+	mv "$report.best" "$report"
+	wall=$(metric "$report" wall_seconds)
+	rss=$(metric "$report" peak_rss_kb)
+	if [ ! -f "$counts" ]; then counts=$report; fi
+	instances=$(metric "$counts" unique_instances)
+	motifsWall=$(metric "$report" wall_seconds motifs)
+	samples=$(metric "$report" samples)
+	samplesWall=$(metric "$report" wall_seconds samples)
+	awk -v t="$tool" -v g="$graph" -v s="$size" -v m="$motif" -v w="$wall" -v r="$rss" \
+		 -v i="$instances" -v iw="$motifsWall" -v n="$samples" -v nw="$samplesWall" 'BEGIN {
+		printf "%s,%s,%s,%s,%.6f,%d,%d,%.1f,%d,%.3f\n", t, g, s, m, w, r, i,
+				 (iw > 0) ? i/iw : 0, n, (nw > 0) ? n/nw : 0 }' >> "$RESULTS"
+	echo "  $tool $graph $size $motif: ${wall}s"
+}
+
+echo "$GRAPHS" | while read -r file kind flag; do
+	graph=$(basename "$file" | sed 's/\.[a-z]*$//')
+	echo "$graph"
+	if [ "$kind" = "d" ]; then motifs="$MOTIFS_D"; else motifs="$MOTIFS_U"; fi
+	echo "$motifs" | while read -r size id; do
+		out="$WORK/runs/$graph-$size-$id"
+		record mcstats "$graph" $size $id "$out-mcstats.json" "$out-mcstats.json" \
+			"$BIN/mcstats" "$file" $size $id $flag --threads $THREADS --metrics "$out-mcstats.json"
+		record mcextract "$graph" $size $id "$out-mcextract.json" "$out-mcextract.json" \
+			"$BIN/mcextract" "$file" $size $id "$out-extract.gml" $flag --metrics "$out-mcextract.json"
+		record mcc "$graph" $size $id "$out-mcc.json" "$out-mcstats.json" \
+			"$BIN/mcc" "$file" "$out" $SAMPLES $TRIALS $size $id $flag --seed $SEED \
+			--threads $THREADS --metrics "$out-mcc.json"
+	done
+done
+
+# ------------------------------------------------------------------------------------------------
+
+# Store the baseline, or compare the wall times of the cases found in both
+if [ $SAVE -eq 1 ]; then
+	cp "$RESULTS" "$BASELINE" || exit 1
+	echo "Baseline saved to $BASELINE"
+	exit 0
+fi
+if [ ! -f "$BASELINE" ]; then
+	echo "Results in $RESULTS (no baseline to compare with, see --save-baseline)"
+	exit 0
+fi
+awk -F, -v tol="$TOLERANCE" -v least="$MIN_TIME" '
+	FNR == 1 { next }
+	NR == FNR { base[$1 "," $2 "," $3 "," $4] = $5; next }
+	{
+		key = $1 "," $2 "," $3 "," $4
+		if (!(key in base) || base[key] < least || $5 <= 0) next
+		ratio = $5/base[key]
+		compared++
+		if (ratio > tol) {
+			printf "REGRESSION %s: %.4fs against %.4fs (%.2fx slower)\n", key, $5, base[key], ratio
+			regressions++
+		}
+		else if (ratio < 1/tol) {
+			printf "faster     %s: %.4fs against %.4fs (%.2fx speedup)\n", key, $5, base[key], 1/ratio
+		}
+		total += $5; baseTotal += base[key]
+	}
+	END {
+		if (compared > 0) {
+			printf "%d cases compared, %.4fs in total against %.4fs, %d regressions\n", compared, total,
+					 baseTotal, regressions
+		}
+		exit (regressions > 0) ? 1 : 0
+	}' "$BASELINE" "$RESULTS"
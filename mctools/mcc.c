@@ -6,38 +6,116 @@
  *  model that maintains the same size of graph (in nodes) and number of motifs. The directedness 
  *  of the input graph is important as this is then used when finding the correct motif from an 
  *  isomorphic class ID. A debug mode can be enabled at compile time, using the flag -DDEBUG which 
- *  should help understand the steps being performed. A benchmarking flag -DBRENCHMARK is also 
- *  included to time various parts of the process.
+ *  should help understand the steps being performed. The time taken by the main steps, counts of
+ *  the work done and the peak memory use are reported as JSON by the --metrics option.
  *
  *  This command outputs two files:
  *     1. PREFIX_samples.txt - motif clustering coefficient values for the random samples.
- *     2. PREFIX_stats.txt   - statistics from the run.
+ *     2. PREFIX_stats.txt   - statistics from the run (including the seed and samples used).
+ *  and with --cluster-types a third:
+ *     3. PREFIX_types.txt   - count, sample mean, standard deviation and z-score of the pairs of
+ *                             motifs of each clustering type.
  *
  *  Warning: The implemented method here is within the confines of the total number of motifs
  *           in a graph being in the range of hundreds of thousands. Use the debug mode to check 
  *           the number of motifs that have been found and to estimate the running time if problems 
- *           arise.
+ *           arise. For larger graphs the --approx option estimates the coefficient from a sample of
+ *           vertices instead, without keeping any motif instances.
  *
  *------------------------------------------------------------------------------------------------
  *
  *  To compile, use the following command:
  *
- *     gcc -I INC_DIR -L LIB_DIR -O3 mcc.c -ligraph -lstdc++ -o mcc -Wall
+ *     gcc -I INC_DIR -L LIB_DIR -O3 -fopenmp mcc.c mcmotif.c mcgraph.c mccluster.c mcregistry.c
+ *         mcmetrics.c -ligraph -lstdc++ -o mcc -Wall
  *
  *  where INC_DIR is the include directory and LIB_DIR is the library directory. The igraph
  *  library is required to compile this program and can be found at http://igraph.sourceforge.net/
  *  On some systems it is also necessary to link against the GSL Big Number library using -lgmp.
+ *  Without -fopenmp the random samples are generated on a single thread.
  *
  *------------------------------------------------------------------------------------------------
  *
- *  Usage: mcc FILENAME PREFIX SAMPLE TRIALS MOTIF_SIZE MOTIF_ID
+ *  Usage: mcc FILENAME PREFIX SAMPLE TRIALS MOTIF_SIZE MOTIF_ID [--threads N] [--seed S]
+ *             [--tolerance T] [--min-samples N] [--undirected] [--cluster-types] [--approx N]
+ *             [--approx-time T] [--placement single|batch] [--checkpoint] [--resume]
+ *             [--sample-cache DIR] [--shard I/N|auto] [--merge N] [--metrics FILE]
+ *         mcc --batch MANIFEST [--threads N] [--seed S] [--metrics FILE]
  *
- *         FILENAME    : Graph filename (GML format).
+ *         FILENAME    : Graph filename (GML, binary or edge list format, see mcgraph.h).
  *         PREFIX      : Prefix to use on output files.
  *         SAMPLE      : Size of the sample to generate z-score with.
  *         TRIALS      : Number of trails to place motifs in random graph (normally 200).
  *         MOTIF_SIZE  : Size of the motif to consider (3 or 4 nodes).
- *         MOTIF_ID    : Isomorphic class ID (from igraph) for the motif.
+ *         MOTIF_ID    : Isomorphic class ID (from igraph) for the motif, or "all" for every
+ *                       connected motif of the size at once (the outputs then have a row for
+ *                       each motif, led by its ID).
+ *         --threads N : Number of threads generating the random samples (default 1).
+ *         --seed S    : Seed for the random samples (default the current time). For a given seed
+ *                       the samples are the same whatever the number of threads.
+ *         --tolerance T : Stop generating samples once the half width of the 95% confidence
+ *                       interval of the z-score is within T*max(1,|z|), SAMPLE is then the
+ *                       maximum number of samples (default 0, always use SAMPLE samples).
+ *         --min-samples N : Samples generated before stopping early (default 10).
+ *         --undirected : Read an edge list as an undirected graph (default directed).
+ *         --cluster-types : Also count the pairs of motifs of each clustering type (as numbered
+ *                       by mcstats) in the graph and every sample, outputting their z-scores to
+ *                       PREFIX_types.txt (single motifs only). The types are kept between runs
+ *                       in the directory named by MCTOOLS_CACHE if it is set (see mcregistry.h).
+ *         --approx N  : Estimate the coefficient from N vertices drawn with probability
+ *                       proportional to their degree plus one (the motifs holding each one are
+ *                       found and the motifs are counted exactly). The 95% confidence interval
+ *                       of the estimate and the vertices used are added to PREFIX_stats.txt, and
+ *                       every random sample is estimated in the same way from as many vertices.
+ *                       Single motifs without --cluster-types only.
+ *         --approx-time T : Stop drawing vertices for the estimate on the graph after T seconds
+ *                       of wall time (at least 2 are drawn), the samples then use the number
+ *                       drawn. Implies --approx if it is not given.
+ *         --placement P : How motifs are placed in the random samples, "single" (the default)
+ *                       places them one at a time on distinct vertices and checks each one's new
+ *                       motifs locally, "batch" places shrinking batches of motifs as in earlier
+ *                       versions (whose samples it reproduces for a seed).
+ *         --checkpoint : Append a line to PREFIX_checkpoint.txt as each sample is completed,
+ *                       holding the motif ID, sample index, seed, coefficient (-1 if the sample
+ *                       could not be generated), any clustering type counts and "cached" if
+ *                       the sample was taken from --sample-cache.
+ *         --resume    : Continue the run in PREFIX_checkpoint.txt (implies --checkpoint): its
+ *                       completed samples are kept and only the others are generated, with its
+ *                       seed unless --seed is given. The results are those of an uninterrupted run.
+ *         --sample-cache DIR : Keep the random samples in DIR as binary graphs (see mcgraph.h)
+ *                       named sample_NODES_MOTIFS_SIZE_xCODE_D_PLACEMENT_INDEX.bin for the nodes
+ *                       and motifs of the graph and the size, adjacency code (see mcregistry.h)
+ *                       and directedness (d or u) of the motif. Samples found there are used in
+ *                       place of generating them whatever the seed (or trials), so runs sharing
+ *                       the null model share their samples, and the files can be read by mcstats.
+ *                       Such samples are those of the run that cached them rather than of the
+ *                       seed, and are marked as cached in the checkpoint.
+ *         --shard I/N : Only generate shard I (from 0) of N of the samples, a contiguous slice
+ *                       with the same random streams as in a single run, writing them to
+ *                       PREFIX_shard_I.txt in the form of the checkpoint (so --resume continues the
+ *                       shard). The coefficient of the graph is left to the merge and every shard
+ *                       needs the same --seed. With "auto" the shard is the rank of the process
+ *                       and N their number as set by MPI launchers (mpirun, mpiexec) or Slurm
+ *                       (srun), so a single launch runs all shards.
+ *         --merge N   : Read the samples from the N files PREFIX_shard_I.txt (with the seed of the
+ *                       first unless --seed is given) and output the results as a single run with
+ *                       the same seed would, applying any --tolerance. Samples missing from the
+ *                       shards are left out (-2 in PREFIX_samples.txt).
+ *         --metrics FILE : Write a JSON report of the run to FILE (see mcmetrics.h): the wall and
+ *                       CPU time of loading, finding the clustering types, the motifs of the graph,
+ *                       the samples and the output, peak memory and counters of the mappings and
+ *                       instances found in the graph (not the samples) and of the motif placements
+ *                       and samples.
+ *         --batch MANIFEST : Run the jobs listed in MANIFEST, one per line (blank lines and lines
+ *                       starting with # are skipped), each holding the arguments of a single run
+ *                       from FILENAME to MOTIF_ID, optionally led by "mcc", with any of
+ *                       --undirected, --seed, --placement and --cluster-types. Each graph is read
+ *                       once and shared by its jobs, and the motifs of every graph and each random
+ *                       sample are separate tasks taken on by the N threads as they become free,
+ *                       so jobs of very different sizes run side by side. The output files of a
+ *                       job are those of its single run and are written, with a line on the
+ *                       console, as soon as it completes. --seed sets the seed of jobs without
+ *                       one. In the metrics the jobs are timed together as the samples.
  *
  *------------------------------------------------------------------------------------------------
  *
@@ -55,30 +133,294 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <unistd.h>
 #include <igraph.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "mcmotif.h"
+#include "mcgraph.h"
+#include "mccluster.h"
+#include "mcregistry.h"
+#include "mcmetrics.h"
+
+/* Ways of placing the motifs in a random sample (see calc_sample) */
+#define PLACEMENT_SINGLE 0
+#define PLACEMENT_BATCH 1
+
+
+/* Calculates the motif clustering coefficient (no igraph calls are made). If types is not NULL the
+ * pairs of motifs of each clustering type are also counted into typeCounts (see
+ * mc_cluster_census), reusing the same enumeration. If report is set the mappings, instances and
+ * overlapping pairs found are added to the metrics, which only describe the graph being studied
+ * (not its random samples). */
+int motif_clustering (double *res, mc_graph_t *graph, mc_motif_t *motif, 
+							 const mc_cluster_types_t *types, long int *typeCounts, igraph_bool_t report);
+
+/* Calculates the motif clustering coefficient from the index of all proper motif instances. */
+int motif_clustering_overlap (double *res, mc_overlap_t *overlap);
+
+/* Calculates a z-score for a motif clustering coefficient and a set of random samples. Failed
+ * (-1) and missing (-2) samples are left out, the number used is returned in used if it is not
+ * NULL. */
+int z_score (double *res, long int *used, double mcc, igraph_vector_t *samples);
+
+/* Running mean and variance of the sample values (Welford's method). */
+typedef struct {
+	long int n;      /* Number of values added */
+	double mean;     /* Mean of the values */
+	double m2;       /* Sum of squared differences from the mean */
+} zscore_stats_t;
+
+/* Add a sample value to the running statistics. */
+void zscore_add (zscore_stats_t *st, double x);
+
+/* z-score of a motif clustering coefficient given the running statistics. */
+double zscore_value (const zscore_stats_t *st, double mcc);
+
+/* Half width of the 95% confidence interval of the z-score, using the large sample variance
+ * (1 + z^2/2)/n of a standardised difference. */
+double zscore_halfwidth (const zscore_stats_t *st, double mcc);
+
+/* Random number stream used to place motifs in a sample (splitmix64). Every sample has its own
+ * stream derived from the run seed and the sample index, so samples do not depend on how they
+ * are spread over threads. */
+typedef struct {
+	unsigned long long state;   /* Current state of the generator */
+} sample_rng_t;
+
+/* Seed the stream for a sample. */
+void sample_rng_seed (sample_rng_t *rng, unsigned long long seed, long int sample);
+
+/* Next 64-bit value of the stream. */
+unsigned long long sample_rng_next (sample_rng_t *rng);
+
+/* Random integer in the range [0, n). */
+int sample_rng_int (sample_rng_t *rng, int n);
+
+/* Estimates the motif clustering coefficient from a sample of vertices drawn with probability
+ * proportional to their degree plus one. The shared vertices of all pairs of motifs are the sum
+ * over the vertices of the pairs holding each one (see mc_motif_vertex_pairs), so each drawn
+ * vertex weighted by its inverse probability is an unbiased estimate of them, while the number of
+ * motifs is counted exactly. Up to *vertices vertices are drawn, fewer if the time budget (in
+ * seconds of wall time from a monotonic clock, 0 for none) runs out, and *vertices is set to the
+ * number used. If low and high are not NULL they receive the 95% confidence interval of the
+ * coefficient, and if count is not NULL the number of motifs (no igraph calls are made). */
+int motif_clustering_approx (double *res, double *low, double *high, long int *vertices,
+									  igraph_integer_t *count, mc_graph_t *graph, mc_motif_t *motif,
+									  double seconds, sample_rng_t *rng);
+
+/* Random sample being built by calc_sample. The edge list doubles as an undo log: edges added
+ * since the last commit can be rolled back by removing them from the view and truncating it.
+ * Each thread keeps one sample as its workspace and reuses it for all of its samples. */
+typedef struct {
+	mc_graph_t view;          /* Adjacency used to count motifs */
+	int *from;                /* Edges added so far ... */
+	int *to;                  /* ... */
+	long int edges;           /* Number of edges added */
+	long int capacity;        /* Room allocated for the edge list */
+	long int mark;            /* Number of edges at the last commit */
+} sample_graph_t;
 
+/* Initialise an empty sample. */
+int sample_init (sample_graph_t *sg, igraph_integer_t nodes, igraph_bool_t directed);
 
-/* Maximum attempts placing a single motif before giving up */
-long int MAX_MOTIF_TRIALS;
+/* Add a batch of edges to the sample. */
+int sample_add_edges (sample_graph_t *sg, const int *from, const int *to, long int edges);
 
+/* Keep the edges added since the last commit. */
+void sample_commit (sample_graph_t *sg);
 
-/* Calculates the motif clustering coefficient. */
-int motif_clustering (double *res, igraph_t* graph, igraph_t *motif);
+/* Remove the edges added since the last commit. */
+void sample_rollback (sample_graph_t *sg);
 
-/* Calculates a z-score for a motif clustering coefficient and a set of random samples. */
-int z_score (double *res, double mcc, igraph_vector_t *samples);
+/* Remove all edges from the sample so it can be reused. */
+void sample_clear (sample_graph_t *sg);
+
+/* Free memory used by the sample. */
+void sample_destroy (sample_graph_t *sg);
+
+/* Options controlling the generation of the random samples. */
+typedef struct {
+	int samples;              /* Number of samples (the maximum when stopping early) */
+	int minSamples;           /* Samples always used before stopping early */
+	double tolerance;         /* Stop once the z-score interval half width is within this fraction
+	                             of max(1, |z|), 0 to always use all samples */
+	int threads;              /* Number of threads generating samples */
+	unsigned long long seed;  /* Seed of the random streams */
+	long int approxVertices;  /* Vertices drawn to estimate the coefficient of each sample, 0 to
+	                             calculate it exactly */
+	int placement;            /* How motifs are placed in a sample (PLACEMENT_SINGLE or _BATCH) */
+	long int trials;          /* Attempts placing motifs in a sample before giving up */
+	int motifId;              /* ID of the motif, as written to the checkpoint */
+	FILE *checkpoint;         /* Receives a line for each completed sample, NULL for none */
+	const char *resume;       /* Checkpoint whose samples are reused, NULL to generate them all */
+	const char *cache;        /* Directory of cached sample graphs, NULL for none */
+	int shard;                /* Slice of the samples generated by this shard of ... */
+	int shards;               /* ... shards (0 to generate all samples) */
+	int merge;                /* Number of shards whose samples are merged, 0 for none */
+	const char *prefix;       /* Prefix of the output files (and the shard files merged) */
+} sample_options_t;
 
 /* Generates random graphs of a given number of nodes, containing a specified number of different
- * motif types. Uses the function calc_sample to calculate a graph. */
-int calc_samples (igraph_vector_t *res, igraph_t *graph, igraph_t *motif, 
-						igraph_integer_t count, igraph_integer_t nodes, int samples);
+ * motif types. Uses the function calc_sample to calculate a graph. Samples are spread over a
+ * number of threads when compiled with OpenMP. With a tolerance the samples are generated in 
+ * blocks and only those up to the first one at which the z-score of mcc is precise enough are 
+ * kept, so the result is the same whatever the number of threads. If types is not NULL the
+ * clustering types of each sample are counted into typeCounts (types->count+1 entries for each
+ * of the opts->samples samples). Samples read from the resumed checkpoint are not generated again,
+ * completed ones are written to the checkpoint as they finish and sample graphs are taken from
+ * (or added to) the cache directory. A shard only generates its slice of the samples (the others
+ * are left at -2 and not used) and a merge reads every sample from the shard files instead of
+ * generating it. */
+int calc_samples (igraph_vector_t *res, mc_graph_t *graph, mc_motif_t *motif, 
+						igraph_integer_t count, igraph_integer_t nodes, double mcc,
+						const sample_options_t *opts, const mc_cluster_types_t *types,
+						long int *typeCounts);
+
+/* Shard and number of shards of this process from the rank and size set by MPI launchers
+ * (Open MPI, MPICH and other PMI based ones) or Slurm. Returns 1 if none are set. */
+int shard_from_environment (int *shard, int *shards);
+
+/* Name of the cached graph of a sample in the directory of --sample-cache. Samples are keyed by
+ * the nodes, number of motifs, motif (size, adjacency and directedness) and placement, so any run
+ * with the same null model finds them, and by their index. */
+void sample_cache_name (char *filename, size_t length, const char *dir, const mc_motif_t *motif,
+								igraph_integer_t count, igraph_integer_t nodes, int placement,
+								long int sample);
+
+/* Seed of the first sample in a checkpoint and the length of its complete lines (a sample being
+ * written when a run was stopped may leave a partial line at the end). Returns 1 if the file
+ * cannot be read. */
+int checkpoint_seed (const char *filename, unsigned long long *seed, long int *length);
+
+/* Reads the samples of a motif and seed completed by an earlier run from a checkpoint into res
+ * (and typeCounts, entries per sample, if it is not NULL), marking them in done. Samples without
+ * all of the type counts are left to be generated again. Samples marked as taken from the sample
+ * cache are read in the same way. */
+int checkpoint_read (const char *filename, const sample_options_t *opts, igraph_vector_t *res,
+							long int *typeCounts, long int entries, char *done);
+
+/* Appends the line of a completed sample to the checkpoint: the motif ID, sample index, seed,
+ * coefficient (-1 if it could not be generated), any type counts and, if the sample graph was
+ * taken from the sample cache rather than generated from the seed, a final "cached". */
+void checkpoint_write (FILE *out, const sample_options_t *opts, long int sample, double mcc,
+							  const long int *counts, long int entries, igraph_bool_t cached);
+
+/* Outputs the number of motif pairs of each clustering type in the graph along with their mean,
+ * standard deviation and z-score over the random samples to PREFIX_types.txt. */
+int cluster_type_stats (const char *prefix, const mc_cluster_types_t *types, 
+								const long int *realCounts, const long int *typeCounts, 
+								igraph_vector_t *samples);
 
-/* Calculates a single random sample, containing a specified number of different motif types. */
-int calc_sample (igraph_t *res, igraph_t* graph, igraph_t *motif, 
-					  igraph_integer_t count, igraph_integer_t nodes);
+/* Calculates a single random sample, containing a specified number of different motif types. The
+ * sample is built in the (cleared) workspace sg, placing the motifs with calc_sample_single or
+ * calc_sample_batch. */
+int calc_sample (sample_graph_t *sg, mc_motif_t *motif, igraph_integer_t count, int placement,
+					  long int maxTrials, sample_rng_t *rng);
+
+/* Places motifs one at a time on distinct random vertices, adding only the motif edges the sample
+ * does not hold yet. The motifs a placement creates are counted locally (see
+ * mc_motif_count_local) and it is kept only if it adds motifs without exceeding count, so the
+ * sample reaches count in about count placements. Gives up after maxTrials placements in a row
+ * are rejected. */
+int calc_sample_single (sample_graph_t *sg, mc_motif_t *motif, igraph_integer_t count, 
+								long int maxTrials, sample_rng_t *rng);
+
+/* Places batches of motifs on random vertices, starting with count/5 motifs and shrinking the
+ * batch whenever it would exceed count. Gives up after maxTrials placements of single
+ * motifs in a row are rejected. */
+int calc_sample_batch (sample_graph_t *sg, mc_motif_t *motif, igraph_integer_t count, 
+							  long int maxTrials, sample_rng_t *rng);
 
 /* Count the number of motifs in a graph. */
-igraph_integer_t motif_count (igraph_t *graph, igraph_t *motif);
+igraph_integer_t motif_count (mc_graph_t *graph, mc_motif_t *motif);
+
+/* Aggregates the motif mappings found by the enumeration as they are visited. */
+typedef struct {
+	mc_graph_t *graph;       /* Graph being searched */
+	mc_motif_t *motif;       /* Motif being searched for */
+	long int mapsCount;      /* Number of mappings visited */
+	long int actMaps;        /* Number of mappings that are proper motifs */
+	mc_overlap_t *overlap;   /* Index receiving the proper motifs */
+} motif_visit_t;
+
+/* Checks a single mapping and adds it to the aggregated results. */
+igraph_bool_t motif_visit (const int *map, void *arg);
+
+/* Calculates the motif clustering coefficient and z-score of every connected motif of a size
+ * (3 or 4 nodes), enumerating the connected subgraphs of the graph only once. Outputs combined
+ * PREFIX_samples.txt and PREFIX_stats.txt files with a row for each motif. */
+int all_motifs (const char *prefix, mc_graph_file_t *graph, int motifSize, 
+					 const sample_options_t *opts);
+
+/* Buckets the connected subgraphs found by the enumeration into motif instances. */
+typedef struct {
+	mc_isoclass_t *classes;  /* Isomorphism class of each subgraph adjacency code */
+	long int *copies;        /* Instances of motif class m in a subgraph of class c (c*classes+m) */
+	mc_overlap_t *overlaps;  /* Index of the instances of each class */
+} census_visit_t;
+
+/* Adds the motif instances of a single connected subgraph to the index of each class. */
+igraph_bool_t census_visit (const int *set, long int code, void *arg);
+
+/* Graph of a batch run, loaded once and shared (read only) by all of its jobs. */
+typedef struct {
+	char filename[1000];         /* File the graph is read from ... */
+	igraph_bool_t directed;      /* ... as a directed or undirected edge list */
+	igraph_bool_t loaded;        /* Whether it could be read */
+	mc_graph_file_t file;        /* The graph */
+	sample_graph_t *workspaces;  /* Sample workspace of each thread for the graph ... */
+	char *ready;                 /* ... built when the thread first generates one of its samples */
+} batch_graph_t;
+
+/* Job of a batch run, a single run of mcc on one of the graphs. */
+typedef struct {
+	long int line;               /* Line of the job in the manifest */
+	char prefix[1000];           /* Prefix of the output files */
+	long int graph;              /* Index of the graph of the job */
+	int motifSize;               /* Size of the motif ... */
+	mc_motif_t *motif;           /* ... (owned by the registry), NULL if the job cannot run */
+	igraph_bool_t clusterTypes;  /* Whether the clustering types are counted ... */
+	mc_cluster_types_t *types;   /* ... as these types */
+	sample_options_t opts;       /* Samples, trials, seed and placement of the job */
+	igraph_integer_t count;      /* Number of motifs in the graph */
+	double mcc;                  /* Motif clustering coefficient of the graph */
+	igraph_vector_t samples;     /* Coefficient of each sample (-1 if it could not be generated) */
+	long int *realCounts;        /* Clustering type counts of the graph ... */
+	long int *typeCounts;        /* ... and of each sample */
+	int remaining;               /* Tasks of the job that have not finished */
+	int status;                  /* 0 once the results have been written */
+} batch_job_t;
+
+/* Runs the jobs of a manifest, each line holding the arguments of a single run of mcc
+ * (FILENAME PREFIX SAMPLE TRIALS MOTIF_SIZE MOTIF_ID with --undirected, --seed S, --placement P
+ * and --cluster-types, optionally led by "mcc"). Every graph and motif is loaded once before the
+ * jobs start, then the motifs of each graph and every random sample are run as separate OpenMP
+ * tasks on a pool of threads, which take on the waiting tasks of any job as they become free.
+ * The outputs of each job are the same as those of its single run and written as soon as its
+ * last task finishes. Jobs without a seed use the given one. Returns 1 if any job failed. */
+int batch_run (const char *manifest, int threads, unsigned long long seed);
+
+/* Reads a line of the manifest into a job and the graph file it needs. Returns 1 (after reporting
+ * the problem) if the line is not a valid job, 2 if it holds no job. */
+int batch_parse (batch_job_t *job, char *filename, igraph_bool_t *directed, char *line,
+					  unsigned long long seed);
+
+/* Counts the motifs of the graph of a job and creates its tasks: the coefficient of the graph
+ * and each of the random samples. */
+void batch_job_start (batch_job_t *job, batch_graph_t *graph);
+
+/* Generates and measures a random sample of a job in the workspace of the calling thread. */
+void batch_sample (batch_job_t *job, batch_graph_t *graph, int s);
+
+/* Marks a task of a job as finished, writing the results of the job after its last task. */
+void batch_task_done (batch_job_t *job, batch_graph_t *graph);
+
+/* Outputs the results of a job to its files and reports them. */
+int batch_output (batch_job_t *job, batch_graph_t *graph);
 
 /* Print usage information. */
 void print_usage (void);
@@ -89,52 +431,403 @@ void print_usage (void);
 /* Main function. */
 int main (int argc, const char * argv[])
 {
-	char filename[1000];
-	FILE *gFile, *outFile;
-	igraph_t G, motif;
-	double resMCC, resZScore;
-	int suc;
+	char filename[1000], checkpointName[1000];
+	FILE *outFile;
+	mc_graph_file_t G;
+	mc_descriptor_t *desc;
+	mc_motif_t *motif;
+	double resMCC, resZScore, lowMCC, highMCC, approxSeconds;
+	int suc, i, positional;
+	const char *args[6];
+	igraph_bool_t directed, clusterTypes, checkpoint, resume, seedGiven;
+	sample_options_t opts;
+	long int length, used;
 	igraph_integer_t x, count;
 	igraph_vector_t samples;
-#ifdef BENCHMARK
-	clock_t ctime_1, ctime_2;
-	ctime_1 = clock();
-#endif
+	mc_cluster_types_t *types;
+	long int *realCounts, *typeCounts;
+	sample_rng_t rng;
+	unsigned long long resumeSeed;
+	const char *metrics, *batch;
 	
 	/* Check that there are enough arguments */	
 	if (argc == 2 && strcmp(argv[1], "-h") == 0) {
 		print_usage();
 		return 0;
 	}
-	if ((argc < 2) || (argc < 7) || (argc > 7)) {
+	
+	/* Separate the options from the positional arguments */
+	opts.threads = 1;
+	opts.seed = (unsigned long long)time(NULL);
+	opts.tolerance = 0.0;
+	opts.minSamples = 10;
+	opts.approxVertices = 0;
+	opts.placement = PLACEMENT_SINGLE;
+	opts.motifId = 0;
+	opts.checkpoint = NULL;
+	opts.resume = NULL;
+	opts.cache = NULL;
+	opts.shard = 0;
+	opts.shards = 0;
+	opts.merge = 0;
+	opts.prefix = NULL;
+	metrics = NULL;
+	batch = NULL;
+	approxSeconds = 0.0;
+	directed = 1;
+	clusterTypes = 0;
+	checkpoint = 0;
+	resume = 0;
+	seedGiven = 0;
+	positional = 0;
+	for (i=1; i<argc; i++) {
+		if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) {
+			opts.threads = atoi(argv[++i]);
+			if (opts.threads < 1) {
+				printf("Invalid number of threads.\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i+1 < argc) {
+			opts.seed = strtoull(argv[++i], NULL, 10);
+			seedGiven = 1;
+		}
+		else if (strcmp(argv[i], "--tolerance") == 0 && i+1 < argc) {
+			opts.tolerance = atof(argv[++i]);
+			if (opts.tolerance < 0.0) {
+				printf("Invalid tolerance.\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--min-samples") == 0 && i+1 < argc) {
+			opts.minSamples = atoi(argv[++i]);
+			if (opts.minSamples < 2) {
+				printf("Invalid minimum number of samples.\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--undirected") == 0) {
+			directed = 0;
+		}
+		else if (strcmp(argv[i], "--cluster-types") == 0) {
+			clusterTypes = 1;
+		}
+		else if (strcmp(argv[i], "--approx") == 0 && i+1 < argc) {
+			opts.approxVertices = atol(argv[++i]);
+			if (opts.approxVertices < 2) {
+				printf("Invalid number of vertices to approximate with.\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--approx-time") == 0 && i+1 < argc) {
+			approxSeconds = atof(argv[++i]);
+			if (approxSeconds <= 0.0) {
+				printf("Invalid approximation time.\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--placement") == 0 && i+1 < argc) {
+			i++;
+			if (strcmp(argv[i], "single") == 0) {
+				opts.placement = PLACEMENT_SINGLE;
+			}
+			else if (strcmp(argv[i], "batch") == 0) {
+				opts.placement = PLACEMENT_BATCH;
+			}
+			else {
+				printf("Invalid placement, use single or batch.\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--checkpoint") == 0) {
+			checkpoint = 1;
+		}
+		else if (strcmp(argv[i], "--resume") == 0) {
+			checkpoint = 1;
+			resume = 1;
+		}
+		else if (strcmp(argv[i], "--sample-cache") == 0 && i+1 < argc) {
+			opts.cache = argv[++i];
+		}
+		else if (strcmp(argv[i], "--shard") == 0 && i+1 < argc) {
+			i++;
+			if (strcmp(argv[i], "auto") == 0) {
+				if (shard_from_environment(&opts.shard, &opts.shards) != 0) {
+					printf("No MPI or Slurm rank found for --shard auto.\n");
+					return 1;
+				}
+			}
+			else if (sscanf(argv[i], "%i/%i", &opts.shard, &opts.shards) != 2 || opts.shards < 1 ||
+						opts.shard < 0 || opts.shard >= opts.shards) {
+				printf("Invalid shard, use I/N with 0 <= I < N.\n");
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--metrics") == 0 && i+1 < argc) {
+			metrics = argv[++i];
+		}
+		else if (strcmp(argv[i], "--batch") == 0 && i+1 < argc) {
+			batch = argv[++i];
+		}
+		else if (strcmp(argv[i], "--merge") == 0 && i+1 < argc) {
+			opts.merge = atoi(argv[++i]);
+			if (opts.merge < 1) {
+				printf("Invalid number of shards to merge.\n");
+				return 1;
+			}
+		}
+		else if (positional < 6) {
+			args[positional++] = argv[i];
+		}
+		else {
+			positional++;
+		}
+	}
+	if (positional != 6 && batch == NULL) {
 		printf("Invalid number of arguments.\n");
 		return 1;
 	}
+	if (approxSeconds > 0.0 && opts.approxVertices == 0) {
+		opts.approxVertices = LONG_MAX;
+	}
+	if (metrics != NULL) {
+		mc_metrics_enable();
+	}
+	if (opts.shards > 0 && opts.merge > 0) {
+		printf("A run cannot be both a shard and a merge.\n");
+		return 1;
+	}
+	if (opts.shards > 0 && seedGiven == 0) {
+		printf("Shards need a --seed shared by all of them.\n");
+		return 1;
+	}
+	if (opts.shards > 0 && approxSeconds > 0.0) {
+		printf("Shards need the number of vertices of --approx, --approx-time cannot be used.\n");
+		return 1;
+	}
+	
+#ifndef _OPENMP
+	if (opts.threads > 1) {
+		printf("Warning: compiled without OpenMP, samples are generated on a single thread.\n");
+		fflush(stdout);
+	}
+#endif
+	
+	/* Jobs of a manifest, each with its own arguments */
+	if (batch != NULL) {
+		if (positional != 0) {
+			printf("The jobs of a batch are given by its manifest, not the command line.\n");
+			return 1;
+		}
+		suc = batch_run(batch, opts.threads, opts.seed);
+		if (metrics != NULL && mc_metrics_write(metrics, "mcc", argc, argv) != 0) {
+			printf("Could not write the metrics to %s.\n", metrics);
+		}
+		mc_registry_clear();
+		
+		return suc;
+	}
+	
+	opts.trials = atol(args[3]);
+	opts.samples = atoi(args[2]);
+	opts.motifId = atoi(args[5]);
+	opts.prefix = args[1];
+	
+	/* Shards generate all of their slice (the tolerance is applied when merging) and merges take
+	   their seed from the first shard unless one is given */
+	if (opts.shards > 0) {
+		opts.tolerance = 0.0;
+	}
+	if (opts.merge > 0 && seedGiven == 0) {
+		sprintf(checkpointName, "%s_shard_0.txt", args[1]);
+		if (checkpoint_seed(checkpointName, &resumeSeed, &length) != 0) {
+			printf("Could not read shard file %s.\n", checkpointName);
+			return 1;
+		}
+		opts.seed = resumeSeed;
+	}
+	
+	/* Load the user specified topology (any format, see mcgraph.h) */
+	mc_metrics_begin(MC_PHASE_LOAD);
+	if (mc_graph_file_open(&G, args[0], directed) != 0) {
+		printf("Could not read graph from %s.\n", args[0]);
+		return 1;
+	}
+	mc_metrics_end(MC_PHASE_LOAD);
+	
+	/* Checkpoint of the completed samples, a resumed run continues the one it holds (with its seed
+	   unless another is given) after dropping any partial line left when it was stopped */
+	if (checkpoint != 0 || opts.shards > 0) {
+		if (opts.shards > 0) {
+			sprintf(checkpointName, "%s_shard_%i.txt", args[1], opts.shard);
+		}
+		else {
+			sprintf(checkpointName, "%s_checkpoint.txt", args[1]);
+		}
+		if (resume != 0) {
+			if (checkpoint_seed(checkpointName, &resumeSeed, &length) == 0 && 
+				 truncate(checkpointName, (off_t)length) == 0) {
+				if (seedGiven == 0) {
+					opts.seed = resumeSeed;
+				}
+				opts.resume = checkpointName;
+			}
+			else {
+				printf("Warning: no checkpoint to resume from, all samples are generated.\n");
+				fflush(stdout);
+			}
+		}
+		opts.checkpoint = fopen(checkpointName, (opts.resume != NULL) ? "a" : "w");
+		if (opts.checkpoint == NULL) {
+			printf("Could not write the checkpoint to %s.\n", checkpointName);
+			mc_graph_file_close(&G);
+			return 1;
+		}
+		if (opts.resume == NULL) {
+			fprintf(opts.checkpoint, "Motif, Sample, Seed, MCC, Type Counts, Cached\n");
+			fflush(opts.checkpoint);
+		}
+	}
+	
+	/* All motifs of the size at once */
+	if (strcmp(args[5], "all") == 0) {
+		if (clusterTypes != 0) {
+			printf("Warning: clustering types are not calculated for all motifs at once.\n");
+			fflush(stdout);
+		}
+		if (opts.approxVertices > 0) {
+			printf("Warning: the coefficients of all motifs at once are calculated exactly.\n");
+			fflush(stdout);
+			opts.approxVertices = 0;
+		}
+		suc = all_motifs(args[1], &G, atoi(args[4]), &opts);
+		if (metrics != NULL && mc_metrics_write(metrics, "mcc", argc, argv) != 0) {
+			printf("Could not write the metrics to %s.\n", metrics);
+		}
+		mc_registry_clear();
+		mc_graph_file_close(&G);
+		if (opts.checkpoint != NULL) {
+			fclose(opts.checkpoint);
+		}
+		
+		return suc;
+	}
+	
+	/* Descriptor of the motif (symmetries and search plan) from the registry */
+	desc = mc_registry_motif(atoi(args[4]), atoi(args[5]), G.view.directed);
+	if (desc == NULL) {
+		printf("Invalid motif size or ID.\n");
+		mc_graph_file_close(&G);
+		if (opts.checkpoint != NULL) {
+			fclose(opts.checkpoint);
+		}
+		return 1;
+	}
+	motif = &desc->motif;
+	if (opts.approxVertices > 0 && clusterTypes != 0) {
+		printf("Warning: clustering types are not calculated with --approx.\n");
+		fflush(stdout);
+		clusterTypes = 0;
+	}
 	
-	/* Seed the random number generator */
-	srand(time(NULL));
+	/* Clustering types counted for the graph and every sample */
+	types = NULL;
+	realCounts = NULL;
+	typeCounts = NULL;
+	if (clusterTypes != 0) {
+		mc_metrics_begin(MC_PHASE_TYPES);
+		types = mc_registry_cluster_types(desc);
+		mc_metrics_end(MC_PHASE_TYPES);
+		if (types == NULL) {
+			printf("Could not find the clustering types of the motif.\n");
+			mc_registry_clear();
+			mc_graph_file_close(&G);
+			if (opts.checkpoint != NULL) {
+				fclose(opts.checkpoint);
+			}
+			return 1;
+		}
+		realCounts = (long int *)malloc(sizeof(long int)*(types->count+1));
+		typeCounts = (long int *)malloc(sizeof(long int)*(types->count+1)*(opts.samples+1));
+	}
 	
-	MAX_MOTIF_TRIALS = (long int)atoi(argv[4]);
+	/* The estimate on the graph has its own random stream (samples use 0 onwards) and fixes the
+	   number of vertices drawn for the samples. Shards leave the graph to the merge. */
+	mc_metrics_begin(MC_PHASE_MOTIFS);
+	resMCC = 0.0;
+	if (opts.shards > 0) {
+		suc = 0;
+	}
+	else if (opts.approxVertices > 0) {
+		sample_rng_seed(&rng, opts.seed, -1);
+		suc = motif_clustering_approx(&resMCC, &lowMCC, &highMCC, &opts.approxVertices, &count,
+												&G.view, motif, approxSeconds, &rng);
+	}
+	else {
+		suc = motif_clustering(&resMCC, &G.view, motif, types, realCounts, 1);
+	}
+	if (suc != 0) {
+		printf("Error: not enough memory to find the motif clustering coefficient.\n");
+		free(realCounts);
+		free(typeCounts);
+		mc_registry_clear();
+		mc_graph_file_close(&G);
+		if (opts.checkpoint != NULL) {
+			fclose(opts.checkpoint);
+		}
+		return 1;
+	}
 	
-	/* Load the user specified topology (GML Format) */
-	gFile = fopen(argv[1], "r");
-	igraph_read_graph_gml(&G, gFile);
-	fclose(gFile);
+	/* The estimate has already counted the motifs */
+	if (opts.approxVertices == 0 || opts.shards > 0) {
+		count = motif_count (&G.view, motif);
+	}
+	mc_metrics_end(MC_PHASE_MOTIFS);
 	
-	/* Create list of motif graphs */
-	igraph_isoclass_create(&motif, atoi(argv[5]), atoi(argv[6]), igraph_is_directed(&G));
+	mc_metrics_begin(MC_PHASE_SAMPLES);
+	suc = calc_samples(&samples, &G.view, motif, count, G.view.nodes, resMCC, &opts, types,
+							 typeCounts);
+	mc_metrics_end(MC_PHASE_SAMPLES);
+	if (suc != 0) {
+		printf("Warning: some random samples could not be generated and are left out of the z-score.\n");
+		fflush(stdout);
+	}
 	
-	suc = motif_clustering(&resMCC, &G, &motif);
+	/* Shards only leave their samples in the shard file */
+	if (opts.shards > 0) {
+		printf("Shard %i of %i: samples written to %s\n", opts.shard, opts.shards, checkpointName);
+		fflush(stdout);
+		if (metrics != NULL && mc_metrics_write(metrics, "mcc", argc, argv) != 0) {
+			printf("Could not write the metrics to %s.\n", metrics);
+		}
+		free(realCounts);
+		free(typeCounts);
+		igraph_vector_destroy(&samples);
+		mc_registry_clear();
+		mc_graph_file_close(&G);
+		fclose(opts.checkpoint);
+		return 0;
+	}
+	suc = z_score(&resZScore, &used, resMCC, &samples);
 	
-	count = motif_count (&G, &motif);
-	suc = calc_samples(&samples, &G, &motif, count, igraph_vcount(&G), atoi(argv[3]));
-	suc = z_score(&resZScore, resMCC, &samples);
+	mc_metrics_begin(MC_PHASE_OUTPUT);
+	if (clusterTypes != 0) {
+		cluster_type_stats(args[1], types, realCounts, typeCounts, &samples);
+		free(realCounts);
+		free(typeCounts);
+	}
 	
-	printf("Motif clustering coefficient = %.8f, z-score = %.8f\n", resMCC, resZScore);
+	if (opts.approxVertices > 0) {
+		printf("Motif clustering coefficient = %.8f (95%% CI %.8f to %.8f from %li vertices), "
+				 "z-score = %.8f\n", resMCC, lowMCC, highMCC, opts.approxVertices, resZScore);
+	}
+	else {
+		printf("Motif clustering coefficient = %.8f, z-score = %.8f\n", resMCC, resZScore);
+	}
 	fflush(stdout);
 	
 	/* Output random samples used to calculate z-score */
-	sprintf(filename, "%s_samples.txt", argv[2]);
+	sprintf(filename, "%s_samples.txt", args[1]);
 	outFile = fopen(filename, "w");
 	for (x=0; x<igraph_vector_size(&samples); x++) {
 		fprintf(outFile, "%.8f\n", (double)VECTOR(samples)[(long int)x]);
@@ -142,171 +835,204 @@ int main (int argc, const char * argv[])
 	fclose(outFile);
 	
 	/* Output the statistics from the run */
-	sprintf(filename, "%s_stats.txt", argv[2]);
+	sprintf(filename, "%s_stats.txt", args[1]);
 	outFile = fopen(filename, "w");
-	fprintf(outFile, "Nodes, Edges, MCC, Z-Score\n");
-	fprintf(outFile, "%li, %li, %.8f, %.8f\n", (long int)igraph_vcount(&G), 
-			  (long int)igraph_ecount(&G), 
-			  resMCC, resZScore);
+	if (opts.approxVertices > 0) {
+		fprintf(outFile, "Nodes, Edges, MCC, Z-Score, Seed, Samples, MCC Low, MCC High, Vertices\n");
+		fprintf(outFile, "%li, %li, %.8f, %.8f, %llu, %li, %.8f, %.8f, %li\n", G.view.nodes, G.edges,
+				  resMCC, resZScore, opts.seed, used, lowMCC,
+				  highMCC, opts.approxVertices);
+	}
+	else {
+		fprintf(outFile, "Nodes, Edges, MCC, Z-Score, Seed, Samples\n");
+		fprintf(outFile, "%li, %li, %.8f, %.8f, %llu, %li\n", G.view.nodes, G.edges, 
+				  resMCC, resZScore, opts.seed, used);
+	}
 	fclose(outFile);
+	mc_metrics_end(MC_PHASE_OUTPUT);
+	if (metrics != NULL && mc_metrics_write(metrics, "mcc", argc, argv) != 0) {
+		printf("Could not write the metrics to %s.\n", metrics);
+	}
 	
 	/* Free used memory and return */
-	igraph_destroy(&motif);
-	igraph_destroy(&G);
-	
-#ifdef BENCHMARK
-	ctime_2 = clock();
-	printf("Motif clustering and z-score calculated in %f seconds\n", (double)(ctime_2 - ctime_1) / 
-			 (double)CLOCKS_PER_SEC);
-	fflush(stdout);
-#endif
+	igraph_vector_destroy(&samples);
+	mc_registry_clear();
+	mc_graph_file_close(&G);
+	if (opts.checkpoint != NULL) {
+		fclose(opts.checkpoint);
+	}
 	
 	return 0;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-int motif_clustering (double *res, igraph_t* graph, igraph_t *motif)
+int motif_clustering (double *res, mc_graph_t *graph, mc_motif_t *motif, 
+							 const mc_cluster_types_t *types, long int *typeCounts, igraph_bool_t report)
 {
-	igraph_integer_t rotSym, motifEdges;
-	long int i, j, motifSize, mapsCount, uniqueMotifs,
-	totSharedVerts, actSharedVerts, posSharedVerts, k, p, found, actMaps;
-	igraph_t subGraphs;
-	igraph_vs_t vs;
-	igraph_vector_t *curi, *curj;
-	igraph_vector_ptr_t maps;
-	igraph_vector_ptr_init(&maps, 0);
-	
-#ifdef BENCHMARK
-	clock_t ctime_1, ctime_2;
-	ctime_1 = clock();
-#endif
-	
-	/* 1. Calculate the size and motif symmetries */
-	motifSize = (long int)igraph_vcount(motif);
-	igraph_count_subisomorphisms_vf2(motif, motif, NULL, NULL, NULL, NULL, &rotSym, NULL, NULL, NULL);
-	
-#ifdef BENCHMARK
-	ctime_2 = clock();
-	printf("Motif count calculated in %f seconds\n", (double)(ctime_2 - ctime_1) / 
-			 (double)CLOCKS_PER_SEC);
-	fflush(stdout);
-	ctime_1 = clock();
-#endif
+	long int motifSize;
+	mc_overlap_t overlap;
+	motif_visit_t visit;
+	int suc;
 	
-	/* 2. Find submorphisms between graph and motif */
-	igraph_get_subisomorphisms_vf2(graph, motif, NULL, NULL, NULL, NULL, &maps, NULL, NULL, NULL);
+	/* 1. Size of the motif (symmetries are held by the motif descriptor) */
+	motifSize = (long int)motif->size;
 	
+	/* 2. Find one mapping between graph and motif for each motif instance, cleaning up and adding
+	      each one to the vertex -> motif index as it is found */
+	mc_overlap_init(&overlap, motifSize, graph->nodes);
+	visit.motif = motif;
+	visit.mapsCount = 0;
+	visit.actMaps = 0;
+	visit.overlap = &overlap;
+	visit.graph = graph;
+	mc_motif_enumerate(graph, motif, 1, motif_visit, &visit);
+	if (report != 0) {
+		mc_metrics_add(MC_COUNT_MAPPINGS, visit.mapsCount);
+		mc_metrics_add(MC_COUNT_REJECTED, visit.mapsCount - visit.actMaps);
+		mc_metrics_add(MC_COUNT_INSTANCES, overlap.count);
+	}
 	
-#ifdef BENCHMARK
-	ctime_2 = clock();
-	printf("All mappings calculated in %f seconds\n", (double)(ctime_2 - ctime_1) / 
-			 (double)CLOCKS_PER_SEC);
+#ifdef DEBUG
+	printf(" mapsCount:%i\n rotSym:%i\n", (int)visit.mapsCount, (int)motif->automorphisms);
 	fflush(stdout);
-	ctime_1 = clock();
 #endif
 	
-	mapsCount = (long int)igraph_vector_ptr_size(&maps);
+	/* 3.-5. Motif clustering coefficient of the proper motifs (one mapping for each) */
+	suc = motif_clustering_overlap(res, &overlap);
 	
-	/* Clean up maps list (only required for directed graphs) */
-	if (igraph_is_directed(graph) != 0) {
-		actMaps = 0;
-		motifEdges = igraph_ecount(motif);
-		for (i=0; i<mapsCount; i++) {
-			
-			curi = (igraph_vector_t *)VECTOR(maps)[i];
-			
-			/* Generate a vertex selector from our IDs vector */
-			igraph_vs_vector(&vs, curi);
-			
-			/* Extract the subgraph using this vertex selector */
-			igraph_induced_subgraph(graph, &subGraphs, vs, IGRAPH_SUBGRAPH_CREATE_FROM_SCRATCH);
-			
-			if (igraph_ecount(&subGraphs) != motifEdges) {
-				/* Remove mapping set first value to -1*/
-				VECTOR(*curi)[0] = -1;
-			}
-			else {
-				actMaps++;
-			}
-
-			igraph_vs_destroy(&vs);
-			igraph_destroy(&subGraphs);
+	/* 6. Clustering types of the pairs of motifs that share vertices (index is now built) */
+	if (types != NULL && suc == 0) {
+		mc_cluster_census(typeCounts, types, graph, motif, &overlap);
+		if (report != 0) {
+			/* Every pair but those sharing no vertex (whether or not they match a type) */
+			mc_metrics_add(MC_COUNT_OVERLAPPING, 
+								overlap.count*(overlap.count-1)/2 - typeCounts[types->count]);
 		}
 	}
-	else {
-		actMaps = mapsCount;
-	}
+	mc_overlap_destroy(&overlap);
+	
+	return suc;
+}
 
-#ifdef BENCHMARK
-	ctime_2 = clock();
-	printf("Mappings cleaned up, calculated in %f seconds\n", (double)(ctime_2 - ctime_1) / 
-			 (double)CLOCKS_PER_SEC);
-	fflush(stdout);
-	ctime_1 = clock();
-#endif
+/*------------------------------------------------------------------------------------------------*/
+
+int motif_clustering_overlap (double *res, mc_overlap_t *overlap)
+{
+	long int motifSize, uniqueMotifs, totSharedVerts, actSharedVerts, posSharedVerts;
 	
-	/* 3. Calculate unique motifs */
-	uniqueMotifs = actMaps / rotSym;
+	motifSize = overlap->size;
 	
-	/* 4. Find actual and total possible shared vertices */
-	totSharedVerts = 0;
+	/* 3. Calculate unique motifs (there is a single instance for each) */
+	uniqueMotifs = overlap->count;
 	
-	/* OpenMP parallel calculations for large graphs */
-#ifdef EXPERIMENTAL
-#pragma omp parallel for default(none) private(i,j,k,p,found,curi,curj) shared(motifSize,mapsCount,totSharedVerts,maps)
-#endif
-	for (i=0; i<mapsCount; i++) {
-		curi = (igraph_vector_t *)VECTOR(maps)[i];
-		if (VECTOR(*curi)[0] != -1) {
-			
-			for (j=i+1; j<mapsCount; j++) {
-				curj = (igraph_vector_t *)VECTOR(maps)[j];
-				
-				if (VECTOR(*curj)[0] != -1) {
-					found = 0;
-					/* Loop through both vectors and see if matching elements are found */
-					for (k=0; k<motifSize; k++) {
-						for (p=0; p<motifSize; p++) {
-							if (VECTOR(*curi)[k] == VECTOR(*curj)[p]) {
-								found++;
-								break;
-							}
-						}
-					}
-					if (found < motifSize) {
-						totSharedVerts += found;
-					}
-				}
-			}
-		}
+	/* 4. Find actual and total possible shared vertices, only pairs of mappings that share a
+	      vertex are visited by using the vertex -> motif index */
+	if (mc_overlap_build(overlap) != 0) {
+		/* Not enough memory for the index */
+		return 1;
 	}
+	totSharedVerts = mc_overlap_shared(overlap);
 	
-	/* OpenMP parallel calculations for large graphs */
-#ifdef EXPERIMENTAL
-#pragma omp parallel for default(none) private(i) shared(posSharedVerts)
-#endif
-	posSharedVerts = 0;
-	for (i=0; i<uniqueMotifs; i++) {
-		posSharedVerts += (motifSize-1)*(uniqueMotifs-i-1);
-	}
+	/* Every pair of motifs could share all but one of their vertices */
+	posSharedVerts = (motifSize-1)*uniqueMotifs*(uniqueMotifs-1)/2;
 	
-	actSharedVerts = totSharedVerts/(rotSym*rotSym);
+	actSharedVerts = totSharedVerts;
 	
 #ifdef DEBUG
-	printf(" mapsCount:%i\n actShVerts:%i\n totShVerts:%i\n rotSym:%i\n motifSize:%i\n uniqueMotifs:%i\n posShVerts:%i\n", 
-			 (int)mapsCount, (int)actSharedVerts, (int)totSharedVerts,
-			 (int)rotSym, (int)motifSize, (int)uniqueMotifs, (int)posSharedVerts);
+	printf(" actShVerts:%i\n totShVerts:%i\n motifSize:%i\n uniqueMotifs:%i\n posShVerts:%i\n", 
+			 (int)actSharedVerts, (int)totSharedVerts,
+			 (int)motifSize, (int)uniqueMotifs, (int)posSharedVerts);
 	fflush(stdout);
 #endif
 	
 	/* 5. Calculate motif clustering coefficient */
 	*res = (double)(actSharedVerts)/(double)posSharedVerts;
 	
-#ifdef BENCHMARK
-	ctime_2 = clock();
-	printf("Motif clustering calculated in %f seconds\n", (double)(ctime_2 - ctime_1) / 
-			 (double)CLOCKS_PER_SEC);
+	return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int motif_clustering_approx (double *res, double *low, double *high, long int *vertices,
+									  igraph_integer_t *count, mc_graph_t *graph, mc_motif_t *motif,
+									  double seconds, sample_rng_t *rng)
+{
+	long int v, k, x, lo, hi, mid, motifs, pairs, *weights;
+	double posSharedVerts, halfWidth;
+	zscore_stats_t st;
+	struct timespec start, now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	
+	/* 1. Number of motifs, counted exactly (no mappings are kept) */
+	motifs = mc_motif_count(graph, motif);
+	if (count != NULL) {
+		*count = (igraph_integer_t)motifs;
+	}
+	posSharedVerts = (double)(motif->size-1)*(double)motifs*(double)(motifs-1)/2.0;
+	
+	/* 2. Cumulative weights of the vertices, their degree plus one so that any vertex (even an
+	      isolated one, as motifs need not be connected) can be drawn */
+	weights = (long int *)malloc(sizeof(long int)*(graph->nodes+1));
+	if (weights == NULL) {
+		return 1;
+	}
+	weights[0] = 0;
+	for (v=0; v<graph->nodes; v++) {
+		weights[v+1] = weights[v] + graph->out[v].size + 1 +
+							((graph->directed != 0) ? graph->in[v].size : 0);
+	}
+	
+	/* 3. Draw vertices, each one's pairs of motifs over its probability estimating the shared
+	      vertices of all pairs */
+	st.n = 0;
+	st.mean = 0.0;
+	st.m2 = 0.0;
+	for (k=0; k<*vertices && graph->nodes > 0; k++) {
+		if (seconds > 0.0 && k >= 2) {
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			if ((double)(now.tv_sec - start.tv_sec) + 1e-9*(double)(now.tv_nsec - start.tv_nsec) >= 
+				 seconds) {
+				break;
+			}
+		}
+		x = (long int)(sample_rng_next(rng) % (unsigned long long)weights[graph->nodes]);
+		lo = 0;
+		hi = graph->nodes-1;
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (weights[mid+1] <= x) {
+				lo = mid + 1;
+			}
+			else {
+				hi = mid;
+			}
+		}
+		pairs = mc_motif_vertex_pairs(graph, motif, (int)lo);
+		if (pairs < 0) {
+			free(weights);
+			return 1;
+		}
+		zscore_add(&st, (double)pairs * (double)weights[graph->nodes] / 
+					  (double)(weights[lo+1] - weights[lo]));
+	}
+	*vertices = k;
+	free(weights);
+	
+	/* 4. Motif clustering coefficient and the 95% confidence interval of the mean */
+	halfWidth = (st.n > 1) ? 1.96*sqrt(st.m2/(double)(st.n-1)/(double)st.n) : INFINITY;
+	*res = st.mean/posSharedVerts;
+	if (low != NULL) {
+		*low = (st.mean - halfWidth > 0.0) ? (st.mean - halfWidth)/posSharedVerts : 0.0;
+	}
+	if (high != NULL) {
+		*high = (st.mean + halfWidth)/posSharedVerts;
+	}
+	
+#ifdef DEBUG
+	printf(" uniqueMotifs:%li\n vertices:%li\n estShVerts:%f (+/- %f)\n posShVerts:%f\n", motifs,
+			 *vertices, st.mean, halfWidth, posSharedVerts);
 	fflush(stdout);
 #endif
 	
@@ -315,135 +1041,605 @@ int motif_clustering (double *res, igraph_t* graph, igraph_t *motif)
 
 /*------------------------------------------------------------------------------------------------*/
 
-int z_score (double *res, double mcc, igraph_vector_t *samples)
+int z_score (double *res, long int *used, double mcc, igraph_vector_t *samples)
 {
-	igraph_integer_t j, sampleSize, actualSamples;
-	double sumMCC, sumMCC2, avgMCC, avgMCC2;
+	long int j, sampleSize;
+	zscore_stats_t st;
 	
 	/* Find the sample size */
 	sampleSize = igraph_vector_size(samples);
-	actualSamples = 0;
 	
-	/* Calculate z-score from the samples */
-	sumMCC  = 0;
-	sumMCC2 = 0;
+	/* Calculate z-score from the samples (failed samples are negative) */
+	st.n = 0;
+	st.mean = 0.0;
+	st.m2 = 0.0;
 	for (j=0; j<sampleSize; j++) {
-		if ((double)VECTOR(*samples)[(long int)j] >= 0.0) {
-			sumMCC  += (double)VECTOR(*samples)[(long int)j];
-			sumMCC2 += pow((double)VECTOR(*samples)[(long int)j], 2.0);
-			actualSamples++;
+		if ((double)VECTOR(*samples)[j] >= 0.0) {
+			zscore_add(&st, (double)VECTOR(*samples)[j]);
 		}
 	}
-	avgMCC  = sumMCC / (double)actualSamples;
-	avgMCC2 = sumMCC2 / (double)actualSamples;
-	*res = (mcc - avgMCC) / sqrt(avgMCC2 - (avgMCC*avgMCC));
+	*res = zscore_value(&st, mcc);
+	if (used != NULL) {
+		*used = st.n;
+	}
 	
 	return 0;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-int calc_samples (igraph_vector_t *res, igraph_t *graph, igraph_t *motif, 
-						igraph_integer_t count, igraph_integer_t nodes, int samples)
+int cluster_type_stats (const char *prefix, const mc_cluster_types_t *types, 
+								const long int *realCounts, const long int *typeCounts, 
+								igraph_vector_t *samples)
 {
-	int s, suc, flag;
-	double *badRes;
-	igraph_t Gs;
-#ifdef BENCHMARK
-	clock_t ctime_1, ctime_2;
-#endif
-	
-	/* Initialise the results vector to the correct size */
-	igraph_vector_init(res, samples);
+	char filename[1000];
+	FILE *outFile;
+	long int t, j;
+	zscore_stats_t st;
 	
-	/* Attempt to generate the number of samples required */
-	flag = 0;
+	sprintf(filename, "%s_types.txt", prefix);
+	outFile = fopen(filename, "w");
+	if (outFile == NULL) {
+		return 1;
+	}
+	fprintf(outFile, "Type, Count, Mean, SD, Z-Score\n");
 	
-	/* OpenMP parallelisation */
-#ifdef EXPERIMENTAL
-#pragma omp parallel for default(none) private(s,j,flag,shared) shared(suc,ctime_1,ctime_2,maps,Gs,motifs,samples,nodes,counts,graph,res)
-#endif
-	for (s=0; s<samples; s++) {
-		
-#ifdef BENCHMARK
-		ctime_1 = clock();
-#endif
-		
-#ifdef DEBUG
-		printf("Generating sample %li of %li\n", (long int)s+1, (long int)samples);
-		fflush(stdout);
-#endif
-		
-		/* Generate a sample */
-		suc = calc_sample(&Gs, graph, motif, count, nodes);
-		
-#ifdef BENCHMARK
-		ctime_2 = clock();
-		printf("Sample calculated in %f seconds\n", (double)(ctime_2 - ctime_1) / 
-				 (double)CLOCKS_PER_SEC);
-#endif
-		
-		if (suc == 1) {
-			badRes = (double *)igraph_vector_e_ptr(res, (igraph_integer_t)s);
-			*badRes = -1.0;
-			flag = 1;
+	/* Statistics over the samples that were generated correctly, the last entry is the pairs of 
+	   motifs that share no vertex */
+	for (t=0; t<=types->count; t++) {
+		st.n = 0;
+		st.mean = 0.0;
+		st.m2 = 0.0;
+		for (j=0; j<igraph_vector_size(samples); j++) {
+			if ((double)VECTOR(*samples)[j] >= 0.0) {
+				zscore_add(&st, (double)typeCounts[j*(types->count+1) + t]);
+			}
+		}
+		if (t < types->count) {
+			fprintf(outFile, "%li, ", t+1);
 		}
 		else {
-			/* Calculate the stats on the graph */
-			motif_clustering(igraph_vector_e_ptr(res, (igraph_integer_t)s), &Gs, motif);
-			/* Free used memory for the sample */
-			igraph_destroy(&Gs);
+			fprintf(outFile, "None, ");
 		}
+		fprintf(outFile, "%li, %.8f, %.8f, %.8f\n", realCounts[t], st.mean, 
+				  sqrt(st.m2 / (double)st.n), zscore_value(&st, (double)realCounts[t]));
 	}
 	
-	if (flag == 1) {
-		/* Some of the samples might not have been generated correctly */
-		return 1;
-	}	
-	
+	fclose(outFile);
 	return 0;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-int calc_sample (igraph_t *res, igraph_t* graph, igraph_t *motif, 
-					  igraph_integer_t count, igraph_integer_t nodes)
+void zscore_add (zscore_stats_t *st, double x)
 {
-	igraph_integer_t j, k, x, curCount, curAdd, newAdd, motifPlaceTrial, edgePlaceTrial,
-	oldCount;
-	igraph_t *G, *altG;
-	igraph_eit_t eit;
-	igraph_vector_t mNodes, newEdges;
-#ifdef BENCHMARK
-	clock_t ctime_1, ctime_2;
+	double delta;
+	
+	st->n++;
+	delta = x - st->mean;
+	st->mean += delta / (double)st->n;
+	st->m2 += delta * (x - st->mean);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+double zscore_value (const zscore_stats_t *st, double mcc)
+{
+	/* Population standard deviation of the samples, as used for the z-score */
+	return (mcc - st->mean) / sqrt(st->m2 / (double)st->n);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+double zscore_halfwidth (const zscore_stats_t *st, double mcc)
+{
+	double z;
+	
+	z = zscore_value(st, mcc);
+	return 1.96 * sqrt((1.0 + 0.5*z*z) / (double)st->n);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int calc_samples (igraph_vector_t *res, mc_graph_t *graph, mc_motif_t *motif, 
+						igraph_integer_t count, igraph_integer_t nodes, double mcc,
+						const sample_options_t *opts, const mc_cluster_types_t *types,
+						long int *typeCounts)
+{
+	int s, suc, failed, first, last, used, block;
+	long int vertices, entries;
+	igraph_bool_t directed, loaded;
+	sample_graph_t Gs;
+	sample_rng_t rng;
+	zscore_stats_t st;
+	mc_graph_file_t cached;
+	mc_graph_t *view;
+	char cacheName[1100], tempName[1200];
+	char *done;
+	double z;
+	
+	/* Initialise the results vector to the correct size */
+	igraph_vector_init(res, opts->samples);
+	directed = graph->directed;
+	entries = (types != NULL) ? types->count+1 : 0;
+	
+	/* Samples completed by the run being resumed */
+	done = (char *)calloc(opts->samples > 0 ? opts->samples : 1, sizeof(char));
+	if (opts->resume != NULL) {
+		checkpoint_read(opts->resume, opts, res, typeCounts, entries, done);
+	}
+	
+	/* Shards skip the samples of the other shards */
+	if (opts->shards > 0) {
+		first = (int)((long int)opts->shard*opts->samples/opts->shards);
+		last = (int)((long int)(opts->shard+1)*opts->samples/opts->shards);
+		for (s=0; s<opts->samples; s++) {
+			if (s < first || s >= last) {
+				VECTOR(*res)[(long int)s] = -2.0;
+				done[s] = 1;
+			}
+		}
+	}
+	
+	/* Merged samples all come from the shard files, those missing are left out */
+	if (opts->merge > 0) {
+		for (s=0; s<opts->merge; s++) {
+			sprintf(cacheName, "%s_shard_%i.txt", opts->prefix, s);
+			if (checkpoint_read(cacheName, opts, res, typeCounts, entries, done) != 0) {
+				printf("Warning: could not read shard file %s.\n", cacheName);
+			}
+		}
+		failed = 0;
+		for (s=0; s<opts->samples; s++) {
+			if (done[s] == 0) {
+				VECTOR(*res)[(long int)s] = -2.0;
+				done[s] = 1;
+				failed++;
+			}
+		}
+		if (failed > 0) {
+			printf("Warning: %i samples are missing from the shards and are left out.\n", failed);
+		}
+		fflush(stdout);
+	}
+	
+	/* Without a tolerance all samples are generated as one block, otherwise blocks keep all
+	   threads busy and the z-score is checked after each one */
+	block = opts->samples;
+	if (opts->tolerance > 0.0) {
+		block = 4*opts->threads;
+	}
+	
+	/* Attempt to generate the number of samples required */
+	failed = 0;
+	used = opts->samples;
+	st.n = 0;
+	st.mean = 0.0;
+	st.m2 = 0.0;
+	first = 0;
+	last = 0;
+	
+	/* OpenMP parallelisation, each thread has its own sample workspace and every sample its own
+	   random stream. Only the motif routines are used inside (igraph is not thread safe) and each
+	   result goes to its own slot, so the results do not depend on the number of threads */
+#ifdef _OPENMP
+#pragma omp parallel num_threads(opts->threads) default(none) \
+	private(s, suc, Gs, rng, z, vertices, loaded, cached, view, cacheName, tempName) \
+	shared(res, motif, count, nodes, mcc, opts, types, typeCounts, directed, block, failed, used, \
+			 st, first, last, entries, done, stdout)
+#endif
+	{
+		sample_init(&Gs, nodes, directed);
+		
+		while (first < used) {
+			
+			/* Next block of samples, the first one holds at least the minimum number */
+#ifdef _OPENMP
+#pragma omp single
+#endif
+			{
+				last = first + block;
+				if (last < opts->minSamples) last = opts->minSamples;
+				if (last > used) last = used;
+			}
+			
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1)
+#endif
+			for (s=first; s<last; s++) {
+				/* Already completed by the resumed run */
+				if (done[s] != 0) {
+					continue;
+				}
+				
+#ifdef DEBUG
+				printf("Generating sample %li of %li\n", (long int)s+1, (long int)opts->samples);
+				fflush(stdout);
+#endif
+				
+				/* Take the sample from the cache (only binary files are opened, which makes no
+				   igraph calls), otherwise generate it and add it to the cache through a temporary
+				   file so that runs sharing the cache never read a partial one */
+				loaded = 0;
+				if (opts->cache != NULL) {
+					sample_cache_name(cacheName, sizeof(cacheName), opts->cache, motif, count, nodes,
+											opts->placement, (long int)s);
+					if (mc_graph_file_format(cacheName) == MC_FORMAT_BINARY &&
+						 mc_graph_file_open(&cached, cacheName, directed) == 0) {
+						if (cached.view.nodes == (long int)nodes && cached.view.directed == directed) {
+							loaded = 1;
+						}
+						else {
+							mc_graph_file_close(&cached);
+						}
+					}
+				}
+				sample_rng_seed(&rng, opts->seed, (long int)s);
+				if (loaded != 0) {
+					suc = 0;
+					view = &cached.view;
+				}
+				else {
+					suc = calc_sample(&Gs, motif, count, opts->placement, opts->trials, &rng);
+					view = &Gs.view;
+					if (suc == 0 && opts->cache != NULL) {
+						snprintf(tempName, sizeof(tempName), "%s.%li.tmp", cacheName, (long int)getpid());
+						if (mc_graph_file_write(tempName, &Gs.view, Gs.edges, NULL) != 0 ||
+							 rename(tempName, cacheName) != 0) {
+							remove(tempName);
+						}
+					}
+				}
+				
+				mc_metrics_add(MC_COUNT_SAMPLES, (suc == 1) ? 0 : 1);
+				mc_metrics_add(MC_COUNT_FAILED, (suc == 1) ? 1 : 0);
+				if (suc == 1) {
+					VECTOR(*res)[(long int)s] = -1.0;
+				}
+				else if (opts->approxVertices > 0) {
+					/* Estimate the stats in the same way as for the graph, continuing the stream
+					   of the sample */
+					vertices = opts->approxVertices;
+					motif_clustering_approx(&VECTOR(*res)[(long int)s], NULL, NULL, &vertices, NULL,
+													view, motif, 0.0, &rng);
+				}
+				else {
+					/* Calculate the stats on the graph, a sample without the memory to do so
+					   counts as failed */
+					if (motif_clustering(&VECTOR(*res)[(long int)s], view, motif, types,
+												(types != NULL) ? typeCounts + s*entries : NULL, 0) != 0) {
+						VECTOR(*res)[(long int)s] = -1.0;
+					}
+				}
+				if (loaded != 0) {
+					mc_graph_file_close(&cached);
+				}
+				
+				/* Record the completed sample */
+				if (opts->checkpoint != NULL) {
+#ifdef _OPENMP
+#pragma omp critical (checkpoint)
+#endif
+					checkpoint_write(opts->checkpoint, opts, (long int)s, 
+										  (double)VECTOR(*res)[(long int)s],
+										  (types != NULL && suc == 0) ? typeCounts + s*entries : NULL, 
+										  entries, loaded);
+				}
+			}
+			
+			/* Add the block to the running statistics in sample order, stopping at the first
+			   sample where the z-score is known well enough */
+#ifdef _OPENMP
+#pragma omp single
+#endif
+			{
+				for (s=first; s<last; s++) {
+					if ((double)VECTOR(*res)[(long int)s] >= 0.0) {
+						zscore_add(&st, (double)VECTOR(*res)[(long int)s]);
+					}
+					else if ((double)VECTOR(*res)[(long int)s] == -1.0) {
+						failed++;
+					}
+					if (opts->tolerance > 0.0 && s+1 >= opts->minSamples && st.n >= 2) {
+						z = zscore_value(&st, mcc);
+						if (isfinite(z) && zscore_halfwidth(&st, mcc) <= 
+							 opts->tolerance * (fabs(z) > 1.0 ? fabs(z) : 1.0)) {
+							used = s+1;
+							break;
+						}
+					}
+				}
+				first = last;
+			}
+		}
+		
+		/* Free used memory for the samples */
+		sample_destroy(&Gs);
+	}
+	
+	/* Only keep the samples that were used */
+	igraph_vector_resize(res, used);
+	free(done);
+	
+#ifdef DEBUG
+	printf("Used %li of %li samples\n", (long int)used, (long int)opts->samples);
+	fflush(stdout);
+#endif
+	
+	if (failed > 0) {
+		/* Some of the samples might not have been generated correctly */
+		return 1;
+	}	
+	
+	return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int shard_from_environment (int *shard, int *shards)
+{
+	static const char *names[] = {"OMPI_COMM_WORLD_RANK", "OMPI_COMM_WORLD_SIZE", "PMI_RANK", 
+											"PMI_SIZE", "SLURM_PROCID", "SLURM_NTASKS"};
+	const char *rank, *size;
+	int i;
+	
+	for (i=0; i<6; i+=2) {
+		rank = getenv(names[i]);
+		size = getenv(names[i+1]);
+		if (rank != NULL && size != NULL) {
+			*shard = atoi(rank);
+			*shards = atoi(size);
+			if (*shards >= 1 && *shard >= 0 && *shard < *shards) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void sample_cache_name (char *filename, size_t length, const char *dir, const mc_motif_t *motif,
+								igraph_integer_t count, igraph_integer_t nodes, int placement,
+								long int sample)
+{
+	snprintf(filename, length, "%s/sample_%li_%li_%i_x%llx_%c_%s_%li.bin", dir, (long int)nodes, 
+				(long int)count, motif->size, mc_registry_code(motif), (motif->directed != 0) ? 'd' : 'u',
+				(placement == PLACEMENT_BATCH) ? "batch" : "single", sample);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int checkpoint_seed (const char *filename, unsigned long long *seed, long int *length)
+{
+	FILE *in;
+	igraph_bool_t found;
+	unsigned long long s;
+	long int sample, pos;
+	int motifId, c;
+	double mcc;
+	
+	in = fopen(filename, "r");
+	if (in == NULL) {
+		return 1;
+	}
+	
+	/* Skip the header, then find the end of the last complete line */
+	found = 0;
+	*length = 0;
+	pos = 0;
+	while ((c = fgetc(in)) != EOF) {
+		pos++;
+		if (c == '\n') {
+			*length = pos;
+		}
+	}
+	rewind(in);
+	while ((c = fgetc(in)) != EOF && c != '\n');
+	if (fscanf(in, "%i, %li, %llu, %lf", &motifId, &sample, &s, &mcc) == 4 && ftell(in) <= *length) {
+		*seed = s;
+		found = 1;
+	}
+	fclose(in);
+	
+	return (found != 0) ? 0 : 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int checkpoint_read (const char *filename, const sample_options_t *opts, igraph_vector_t *res,
+							long int *typeCounts, long int entries, char *done)
+{
+	FILE *in;
+	unsigned long long seed;
+	long int sample, n, e, *counts;
+	int motifId, c;
+	double mcc;
+	char word[8];
+	
+	in = fopen(filename, "r");
+	if (in == NULL) {
+		return 1;
+	}
+	counts = (long int *)malloc(sizeof(long int)*(entries > 0 ? entries : 1));
+	
+	/* Skip the header, then take the complete lines of the motif and seed */
+	while ((c = fgetc(in)) != EOF && c != '\n');
+	while (fscanf(in, "%i, %li, %llu, %lf", &motifId, &sample, &seed, &mcc) == 4) {
+		n = 0;
+		c = fgetc(in);
+		while (c == ',' && n < entries && fscanf(in, "%li", &counts[n]) == 1) {
+			n++;
+			c = fgetc(in);
+		}
+		if (c == ',' && fscanf(in, " %7[a-z]", word) == 1 && strcmp(word, "cached") == 0) {
+			c = fgetc(in);
+		}
+		if (c == '\n' && motifId == opts->motifId && seed == opts->seed && sample >= 0 && 
+			 sample < opts->samples && (n == entries || mcc == -1.0)) {
+			VECTOR(*res)[sample] = mcc;
+			if (typeCounts != NULL && n == entries) {
+				for (e=0; e<entries; e++) {
+					typeCounts[sample*entries + e] = counts[e];
+				}
+			}
+			done[sample] = 1;
+		}
+		while (c != '\n' && c != EOF) {
+			c = fgetc(in);
+		}
+	}
+	
+	free(counts);
+	fclose(in);
+	return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void checkpoint_write (FILE *out, const sample_options_t *opts, long int sample, double mcc,
+							  const long int *counts, long int entries, igraph_bool_t cached)
+{
+	long int e;
+	
+	fprintf(out, "%i, %li, %llu, %.17g", opts->motifId, sample, opts->seed, mcc);
+	if (counts != NULL) {
+		for (e=0; e<entries; e++) {
+			fprintf(out, ", %li", counts[e]);
+		}
+	}
+	fprintf(out, (cached != 0) ? ", cached\n" : "\n");
+	fflush(out);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int calc_sample (sample_graph_t *sg, mc_motif_t *motif, igraph_integer_t count, int placement,
+					  long int maxTrials, sample_rng_t *rng)
+{
+	if (placement == PLACEMENT_BATCH) {
+		return calc_sample_batch(sg, motif, count, maxTrials, rng);
+	}
+	return calc_sample_single(sg, motif, count, maxTrials, rng);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int calc_sample_single (sample_graph_t *sg, mc_motif_t *motif, igraph_integer_t count, 
+								long int maxTrials, sample_rng_t *rng)
+{
+	int nodes, mNodes[MC_MAX_MOTIF], from[MC_MAX_MOTIF*MC_MAX_MOTIF], to[MC_MAX_MOTIF*MC_MAX_MOTIF];
+	long int j, k, x, gCount, before, after, trials, accepts, rejects;
+	
+	/* Start from an empty graph, gCount is the number of motifs it contains */
+	sample_clear(sg);
+	nodes = (int)sg->view.nodes;
+	gCount = mc_motif_count(&sg->view, motif);
+	if (motif->size > nodes) {
+		return (gCount == (long int)count) ? 0 : 1;
+	}
+	
+	trials = 0;
+	accepts = 0;
+	rejects = 0;
+	while (gCount < (long int)count && trials < maxTrials) {
+		
+		/* Distinct random vertices for the motif */
+		for (k=0; k<motif->size; k++) {
+			do {
+				mNodes[k] = sample_rng_int(rng, nodes);
+				for (j=0; j<k && mNodes[j] != mNodes[k]; j++);
+			} while (j < k);
+		}
+		
+		/* Motif edges that are not in the sample yet (ones that are would only become multiple
+		   edges, which stop directed motifs being proper) */
+		x = 0;
+		for (k=0; k<motif->edges; k++) {
+			if (mc_graph_has_edge(&sg->view, mNodes[motif->from[k]], mNodes[motif->to[k]]) == 0) {
+				from[x] = mNodes[motif->from[k]];
+				to[x] = mNodes[motif->to[k]];
+				x++;
+			}
+		}
+		if (x == 0) {
+			trials++;
+			rejects++;
+			continue;
+		}
+		
+		/* Motifs the placement creates, from the motifs touching its edges before and after */
+		before = mc_motif_count_local(&sg->view, motif, from, to, x);
+		sample_add_edges(sg, from, to, x);
+		after = mc_motif_count_local(&sg->view, motif, from, to, x);
+		
+		if (after > before && gCount + after - before <= (long int)count) {
+			sample_commit(sg);
+			gCount += after - before;
+			trials = 0;
+			accepts++;
+		}
+		else {
+			sample_rollback(sg);
+			trials++;
+			rejects++;
+		}
+		
+#ifdef DEBUG
+		printf("%s placement, %li motifs of %li, trial %li\n", (trials == 0) ? "Accepted" : 
+				 "Rejected", gCount, (long int)count, trials);
+		fflush(stdout);
 #endif
+	}
+	mc_metrics_add(MC_COUNT_TRIALS, accepts + rejects);
+	mc_metrics_add(MC_COUNT_ACCEPTS, accepts);
+	mc_metrics_add(MC_COUNT_REJECTS, rejects);
 	
-	/* Generate the initially empty graph to contain the final sample */
-	G = (igraph_t *)malloc(sizeof(igraph_t));
-	igraph_empty(G, nodes, igraph_is_directed(graph));
+	if (gCount != (long int)count) {
+#ifdef DEBUG
+		printf("Exceeded number of motif trials\n");
+		fflush(stdout);
+#endif
+		return 1;
+	}
 	
-	igraph_vector_init(&mNodes, igraph_vcount(motif));
+	/* The valid graph sample is left in sg */
+	return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int calc_sample_batch (sample_graph_t *sg, mc_motif_t *motif, igraph_integer_t count, 
+							  long int maxTrials, sample_rng_t *rng)
+{
+	igraph_integer_t j, k, curCount, curAdd, newAdd, motifPlaceTrial, edgePlaceTrial,
+	oldCount;
+	int nodes, mNodes[MC_MAX_MOTIF];
+	long int x, gCount, before, after;
+	long int accepts, rejects;
+	int *from, *to;
 	
-	/* Update the iterator for the edges in the motif */
-	igraph_eit_create(motif, igraph_ess_all(IGRAPH_EDGEORDER_ID), &eit);
+	/* Start from an empty graph to contain the final sample, gCount is the number of motifs it
+	   contains and is updated using only the motifs touching each batch of new edges */
+	sample_clear(sg);
+	nodes = (int)sg->view.nodes;
+	gCount = mc_motif_count(&sg->view, motif);
 	
 	/* Keep adding motifs until the count for current motif is correct */
 	oldCount = 0;
 	curCount = 0;
 	motifPlaceTrial = 0;
 	edgePlaceTrial = 0;
+	accepts = 0;
+	rejects = 0;
 	curAdd = (igraph_integer_t)((long int)count / 5);
 	if ((long int)curAdd < 1) curAdd = 1;
 	
-	while ((long int)motifPlaceTrial < MAX_MOTIF_TRIALS) {
-		
-		/* Create the alternative graph adding motif using this mapping */
-		altG = (igraph_t *)malloc(sizeof(igraph_t));
-		igraph_copy(altG, G);
-		
-#ifdef BENCHMARK
-		ctime_1 = clock();
-#endif
+	/* Batches never grow beyond the first one */
+	from = (int *)malloc(sizeof(int)*((long int)curAdd*motif->edges + 1));
+	to = (int *)malloc(sizeof(int)*((long int)curAdd*motif->edges + 1));
+	
+	while ((long int)motifPlaceTrial < maxTrials) {
 			
 #ifdef DEBUG
 			printf("Attempting to add %li motifs\n", (long int)curAdd);
@@ -451,41 +1647,26 @@ int calc_sample (igraph_t *res, igraph_t* graph, igraph_t *motif,
 #endif
 			
 		/* Attempt to add each motif we require */
-		igraph_vector_init(&newEdges, (long int)curAdd*(long int)igraph_ecount(motif)*2);
 		x = 0;
 		for (j=0; j<curAdd; j++) {
 			/* Generate random node IDs to use as mapping for motif */
-			for (k=0; k<igraph_vcount(motif); k++) {
-				VECTOR(mNodes)[(long int)k] = (igraph_real_t)(rand() % (int)nodes);
+			for (k=0; k<motif->size; k++) {
+				mNodes[(long int)k] = sample_rng_int(rng, nodes);
 			}
-			IGRAPH_EIT_RESET(eit);
-			do {
-				VECTOR(newEdges)[(long int)x] = VECTOR(mNodes)[(long int)IGRAPH_FROM(motif, 
-																											IGRAPH_EIT_GET(eit))];
-				VECTOR(newEdges)[(long int)x+1] = VECTOR(mNodes)[(long int)IGRAPH_TO(motif, 
-																											IGRAPH_EIT_GET(eit))];
-				x = x + 2;
-				IGRAPH_EIT_NEXT(eit);
-			} while (!IGRAPH_EIT_END(eit));
-		}
-		igraph_add_edges(altG, &newEdges, 0);
-		igraph_vector_destroy(&newEdges);
-		
-#ifdef BENCHMARK
-		ctime_2 = clock();
-		printf("Added %li motifs/edge in %f seconds\n", (long int)curAdd, (double)(ctime_2 - 
-																											ctime_1) / (double)CLOCKS_PER_SEC);
-		ctime_1 = clock();
-#endif
+			/* Map the edges of the motif */
+			for (k=0; k<motif->edges; k++) {
+				from[x] = mNodes[motif->from[(long int)k]];
+				to[x] = mNodes[motif->to[(long int)k]];
+				x++;
+			}
+		}
 		
-		/* Count the motifs in the new graph */
-		curCount = motif_count(altG, motif);
+		/* Count the motifs touching the new edges before and after adding them */
+		before = mc_motif_count_local(&sg->view, motif, from, to, x);
+		sample_add_edges(sg, from, to, x);
 		
-#ifdef BENCHMARK
-		ctime_2 = clock();
-		printf("Calculated new motif counts in %f seconds\n", (double)(ctime_2 - ctime_1) / 
-				 (double)CLOCKS_PER_SEC);
-#endif
+		after = mc_motif_count_local(&sg->view, motif, from, to, x);
+		curCount = (igraph_integer_t)(gCount + after - before);
 		
 		if (curCount < count && curCount != oldCount) {
 			/* Accept change, recalculate number of motifs to add and loop */
@@ -493,15 +1674,15 @@ int calc_sample (igraph_t *res, igraph_t* graph, igraph_t *motif,
 			if ((long int)newAdd < 1) newAdd = 1;
 			if ((long int)newAdd < (long int)curAdd) curAdd = newAdd;
 			
-			if ((long int)motifPlaceTrial < MAX_MOTIF_TRIALS) {
+			if ((long int)motifPlaceTrial < maxTrials) {
 				motifPlaceTrial = 0;
 			}
 			else {
 				edgePlaceTrial++;
 			}
-			igraph_destroy(G);
-			free(G);
-			G = altG;
+			sample_commit(sg);
+			gCount = (long int)curCount;
+			accepts++;
 			
 			oldCount = curCount;
 			
@@ -518,9 +1699,9 @@ int calc_sample (igraph_t *res, igraph_t* graph, igraph_t *motif,
 			/* Counts match for the motif being added and all others <= required number */
 			motifPlaceTrial = 0;
 			edgePlaceTrial = 0;
-			igraph_destroy(G);
-			free(G);
-			G = altG;
+			sample_commit(sg);
+			gCount = (long int)curCount;
+			accepts++;
 			
 #ifdef DEBUG
 			printf("Accepting change, %li motifs of %li, trial %li\n", 
@@ -537,11 +1718,11 @@ int calc_sample (igraph_t *res, igraph_t* graph, igraph_t *motif,
 			curAdd = (igraph_integer_t)((long int)curAdd / (long int)3);
 			if ((long int)curAdd <= 1) {
 				curAdd = 1;
-				if ((long int)motifPlaceTrial < MAX_MOTIF_TRIALS) motifPlaceTrial++;
+				if ((long int)motifPlaceTrial < maxTrials) motifPlaceTrial++;
 				else edgePlaceTrial++;
 			}
-			igraph_destroy(altG);
-			free(altG);
+			sample_rollback(sg);
+			rejects++;
 			
 #ifdef DEBUG
 			printf("Rejecting change, %li motifs instead of %li, trial %li\n", 
@@ -553,127 +1734,770 @@ int calc_sample (igraph_t *res, igraph_t* graph, igraph_t *motif,
 			
 		}
 	}
+	
+	free(from);
+	free(to);
+	mc_metrics_add(MC_COUNT_TRIALS, accepts + rejects);
+	mc_metrics_add(MC_COUNT_ACCEPTS, accepts);
+	mc_metrics_add(MC_COUNT_REJECTS, rejects);
 				
-		/* Free memory used */
-		igraph_eit_destroy(&eit);
-		
 		/* Could not place the motifs so return with error */
 		if (curCount > count) {
 #ifdef DEBUG
 			printf("Exceeded number of motif and single edge trials\n");
 			fflush(stdout);
 #endif
-			igraph_vector_destroy(&mNodes);
-			igraph_destroy(G);
-			free(G);
 			return 1;
 		}
 	
+	/* The valid graph sample is left in sg */
+	return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void sample_rng_seed (sample_rng_t *rng, unsigned long long seed, long int sample)
+{
+	unsigned long long z;
+	
+	/* Scramble the sample index before combining it with the seed so that the streams of
+	   neighbouring samples are unrelated */
+	z = (unsigned long long)sample + 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	rng->state = seed ^ (z ^ (z >> 31));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+unsigned long long sample_rng_next (sample_rng_t *rng)
+{
+	unsigned long long z;
 	
-	/* Return the valid graph sample */
-	igraph_copy(res, G);
+	z = (rng->state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int sample_rng_int (sample_rng_t *rng, int n)
+{
+	return (int)(sample_rng_next(rng) % (unsigned long long)n);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int sample_init (sample_graph_t *sg, igraph_integer_t nodes, igraph_bool_t directed)
+{
+	sg->edges = 0;
+	sg->mark = 0;
+	sg->capacity = 1024;
+	sg->from = (int *)malloc(sizeof(int)*sg->capacity);
+	sg->to = (int *)malloc(sizeof(int)*sg->capacity);
+	
+	return mc_graph_build(&sg->view, (long int)nodes, directed, NULL, NULL, 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int sample_add_edges (sample_graph_t *sg, const int *from, const int *to, long int edges)
+{
+	long int e;
+	
+	if (sg->edges + edges > sg->capacity) {
+		sg->capacity = 2*(sg->edges + edges);
+		sg->from = (int *)realloc(sg->from, sizeof(int)*sg->capacity);
+		sg->to = (int *)realloc(sg->to, sizeof(int)*sg->capacity);
+	}
+	for (e=0; e<edges; e++) {
+		sg->from[sg->edges] = from[e];
+		sg->to[sg->edges] = to[e];
+		sg->edges++;
+		mc_graph_add_edge(&sg->view, from[e], to[e]);
+	}
+	
+	return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void sample_commit (sample_graph_t *sg)
+{
+	sg->mark = sg->edges;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void sample_rollback (sample_graph_t *sg)
+{
+	/* Remove the edges added since the last commit (latest first) and truncate the edge list */
+	while (sg->edges > sg->mark) {
+		sg->edges--;
+		mc_graph_remove_edge(&sg->view, sg->from[sg->edges], sg->to[sg->edges]);
+	}
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void sample_clear (sample_graph_t *sg)
+{
+	sg->mark = 0;
+	sample_rollback(sg);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void sample_destroy (sample_graph_t *sg)
+{
+	mc_graph_destroy(&sg->view);
+	free(sg->from);
+	free(sg->to);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+igraph_integer_t motif_count (mc_graph_t *graph, mc_motif_t *motif)
+{
+	long int count;
+	
+	/* Count the proper motifs using the counting kernel for the motif (no mappings are built) */
+	count = mc_motif_count(graph, motif);
+	
+	return (igraph_integer_t)count;	
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+igraph_bool_t motif_visit (const int *map, void *arg)
+{
+	motif_visit_t *visit = (motif_visit_t *)arg;
+	
+	visit->mapsCount++;
+	
+	/* Clean up mappings (only required for directed graphs) */
+	if (visit->graph->directed != 0 && mc_motif_induced(visit->graph, visit->motif, map) == 0) {
+		/* Not a proper motif, skip it */
+		return 1;
+	}
+	
+	visit->actMaps++;
+	mc_overlap_add(visit->overlap, map);
+	
+	return 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int all_motifs (const char *prefix, mc_graph_file_t *graph, int motifSize, 
+					 const sample_options_t *opts)
+{
+	char filename[1000];
+	FILE *outFile, *statsFile;
+	igraph_t M;
+	mc_graph_t classGraph;
+	mc_isoclass_t classes;
+	mc_motif_t **motifs;
+	mc_overlap_t *overlaps;
+	igraph_bool_t *connected;
+	census_visit_t visit;
+	igraph_vector_t samples;
+	sample_options_t motifOpts;
+	long int c, m, d, n, x, count, used;
+	double resMCC, resZScore;
+	
+	if (mc_isoclass_init(&classes, motifSize, graph->view.directed) != 0) {
+		printf("All motifs can only be found for motifs of 3 or 4 nodes.\n");
+		return 1;
+	}
+	n = classes.classes;
+	
+	/* Descriptors of every class, only connected motifs are formed by the connected subgraphs */
+	motifs = (mc_motif_t **)malloc(sizeof(mc_motif_t *)*n);
+	overlaps = (mc_overlap_t *)malloc(sizeof(mc_overlap_t)*n);
+	connected = (igraph_bool_t *)malloc(sizeof(igraph_bool_t)*n);
+	visit.copies = (long int *)calloc(n*n, sizeof(long int));
+	for (m=0; m<n; m++) {
+		motifs[m] = &mc_registry_motif(motifSize, (int)m, graph->view.directed)->motif;
+		connected[m] = 1;
+		for (d=1; d<motifSize; d++) {
+			if (motifs[m]->anchor[d] < 0) connected[m] = 0;
+		}
+		mc_overlap_init(&overlaps[m], motifSize, graph->view.nodes);
+	}
+	
+	/* Number of instances of each motif in a subgraph of each class, i.e. 1 for the class itself 
+	   for directed graphs and the number of copies of the motif's edges for undirected ones */
+	for (c=0; c<n; c++) {
+		igraph_isoclass_create(&M, motifSize, (igraph_integer_t)c, graph->view.directed);
+		mc_graph_init(&classGraph, &M);
+		for (m=0; m<n; m++) {
+			if (connected[m] != 0) {
+				visit.copies[c*n+m] = mc_motif_count(&classGraph, motifs[m]);
+			}
+		}
+		mc_graph_destroy(&classGraph);
+		igraph_destroy(&M);
+	}
+	
+	/* Enumerate the connected subgraphs once, adding each to the instances of its motifs */
+	visit.classes = &classes;
+	visit.overlaps = overlaps;
+	mc_metrics_begin(MC_PHASE_MOTIFS);
+	mc_subgraph_enumerate(&graph->view, motifSize, graph->view.directed, census_visit, &visit);
+	for (m=0; m<n; m++) {
+		mc_metrics_add(MC_COUNT_INSTANCES, overlaps[m].count);
+	}
+	mc_metrics_end(MC_PHASE_MOTIFS);
+	
+	/* Motif clustering coefficient and z-score of each connected motif (shards only leave their
+	   samples in the shard file) */
+	outFile = NULL;
+	statsFile = NULL;
+	if (opts->shards == 0) {
+		sprintf(filename, "%s_samples.txt", prefix);
+		outFile = fopen(filename, "w");
+		sprintf(filename, "%s_stats.txt", prefix);
+		statsFile = fopen(filename, "w");
+		fprintf(statsFile, "Nodes, Edges, Seed, Motif Size, Motif ID, Motifs, MCC, Z-Score, Samples\n");
+	}
+	for (m=0; m<n; m++) {
+		if (connected[m] == 0) {
+			continue;
+		}
+		count = overlaps[m].count;
+		if (motif_clustering_overlap(&resMCC, &overlaps[m]) != 0) {
+			/* No samples without the coefficient of the graph */
+			printf("Warning: not enough memory to find the coefficient of motif %li.\n", m);
+			fflush(stdout);
+			resMCC = NAN;
+			count = 0;
+		}
+		
+		/* Samples can only be generated (and the coefficient is only defined) for 2+ motifs */
+		if (count >= 2) {
+			motifOpts = *opts;
+			motifOpts.motifId = (int)m;
+			mc_metrics_begin(MC_PHASE_SAMPLES);
+			calc_samples(&samples, &graph->view, motifs[m], (igraph_integer_t)count, 
+							 graph->view.nodes, resMCC, &motifOpts, NULL, NULL);
+			mc_metrics_end(MC_PHASE_SAMPLES);
+			z_score(&resZScore, &used, resMCC, &samples);
+		}
+		else {
+			igraph_vector_init(&samples, 0);
+			resZScore = NAN;
+			used = 0;
+		}
+		
+		if (opts->shards > 0) {
+			igraph_vector_destroy(&samples);
+			continue;
+		}
+		printf("Motif %li: motif clustering coefficient = %.8f, z-score = %.8f\n", m, resMCC, 
+				 resZScore);
+		fflush(stdout);
+		
+		for (x=0; x<igraph_vector_size(&samples); x++) {
+			fprintf(outFile, "%li, %.8f\n", m, (double)VECTOR(samples)[x]);
+		}
+		fprintf(statsFile, "%li, %li, %llu, %i, %li, %li, %.8f, %.8f, %li\n", 
+				  graph->view.nodes, graph->edges, opts->seed, 
+				  motifSize, m, count, resMCC, resZScore, used);
+		igraph_vector_destroy(&samples);
+	}
+	if (opts->shards == 0) {
+		fclose(outFile);
+		fclose(statsFile);
+	}
+	else {
+		printf("Shard %i of %i: samples written to %s_shard_%i.txt\n", opts->shard, opts->shards,
+				 prefix, opts->shard);
+		fflush(stdout);
+	}
 	
 	/* Free used memory */
-	igraph_vector_destroy(&mNodes);
-	igraph_destroy(G);
-	free(G);
+	for (m=0; m<n; m++) {
+		mc_overlap_destroy(&overlaps[m]);
+	}
+	free(motifs);
+	free(overlaps);
+	free(connected);
+	free(visit.copies);
+	mc_isoclass_destroy(&classes);
 	
 	return 0;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-igraph_integer_t motif_count (igraph_t *graph, igraph_t *motif)
+igraph_bool_t census_visit (const int *set, long int code, void *arg)
 {
-	igraph_integer_t rotSym, motifEdges;
-	long int i, motifSize, mapsCount, actMaps;
-	igraph_t subGraphs;
-	igraph_vs_t vs;
-	igraph_vector_t *curi;
-	igraph_vector_ptr_t maps;
-	igraph_vector_ptr_init(&maps, 0);
+	census_visit_t *visit = (census_visit_t *)arg;
+	long int c, m, n, k;
 	
-#ifdef BENCHMARK
-	clock_t ctime_1, ctime_2;
-	ctime_1 = clock();
-#endif
+	n = visit->classes->classes;
+	c = (long int)visit->classes->classOf[code];
+	for (m=0; m<n; m++) {
+		for (k=0; k<visit->copies[c*n+m]; k++) {
+			mc_overlap_add(&visit->overlaps[m], set);
+		}
+	}
+	
+	return 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int batch_run (const char *manifest, int threads, unsigned long long seed)
+{
+	FILE *in;
+	char line[4096], filename[1000];
+	batch_job_t *jobs, job;
+	batch_graph_t *graphs;
+	mc_descriptor_t *desc;
+	long int jobCount, graphCount, number, j, g;
+	igraph_bool_t directed;
+	int t, suc, failed;
+	
+	in = fopen(manifest, "r");
+	if (in == NULL) {
+		printf("Could not read manifest from %s.\n", manifest);
+		return 1;
+	}
 	
-	/* 1. Calculate the size and motif symmetries */
-	motifSize = (long int)igraph_vcount(motif);
-	igraph_count_subisomorphisms_vf2(motif, motif, NULL, NULL, NULL, NULL, &rotSym, NULL, NULL, NULL);
+	/* Read the jobs, adding each graph the first time it is used */
+	mc_metrics_begin(MC_PHASE_LOAD);
+	jobs = NULL;
+	graphs = NULL;
+	jobCount = 0;
+	graphCount = 0;
+	number = 0;
+	failed = 0;
+	while (fgets(line, sizeof(line), in) != NULL) {
+		number++;
+		job.line = number;
+		suc = batch_parse(&job, filename, &directed, line, seed);
+		if (suc == 2) {
+			continue;
+		}
+		if (suc != 0) {
+			failed = 1;
+			continue;
+		}
+		for (g=0; g<graphCount; g++) {
+			if (strcmp(graphs[g].filename, filename) == 0 && graphs[g].directed == directed) {
+				break;
+			}
+		}
+		if (g == graphCount) {
+			graphs = (batch_graph_t *)realloc(graphs, sizeof(batch_graph_t)*(graphCount+1));
+			strcpy(graphs[g].filename, filename);
+			graphs[g].directed = directed;
+			graphs[g].loaded = (mc_graph_file_open(&graphs[g].file, filename, directed) == 0);
+			graphs[g].workspaces = (sample_graph_t *)malloc(sizeof(sample_graph_t)*threads);
+			graphs[g].ready = (char *)calloc(threads, sizeof(char));
+			if (graphs[g].loaded == 0) {
+				printf("Could not read graph from %s.\n", filename);
+			}
+			graphCount++;
+		}
+		job.graph = g;
+		jobs = (batch_job_t *)realloc(jobs, sizeof(batch_job_t)*(jobCount+1));
+		jobs[jobCount++] = job;
+	}
+	fclose(in);
 	
-#ifdef BENCHMARK
-	ctime_2 = clock();
-	printf("Motif count calculated in %f seconds\n", (double)(ctime_2 - ctime_1) / 
-			 (double)CLOCKS_PER_SEC);
+	/* Motif descriptors from the registry (igraph is only used here, before the jobs start) */
+	for (j=0; j<jobCount; j++) {
+		jobs[j].motif = NULL;
+		jobs[j].types = NULL;
+		jobs[j].realCounts = NULL;
+		jobs[j].typeCounts = NULL;
+		jobs[j].status = 1;
+		igraph_vector_init(&jobs[j].samples, jobs[j].opts.samples);
+		if (graphs[jobs[j].graph].loaded == 0) {
+			failed = 1;
+			continue;
+		}
+		desc = mc_registry_motif(jobs[j].motifSize, jobs[j].opts.motifId, 
+										 graphs[jobs[j].graph].file.view.directed);
+		if (desc == NULL) {
+			printf("Line %li: invalid motif size or ID.\n", jobs[j].line);
+			failed = 1;
+			continue;
+		}
+		if (jobs[j].clusterTypes != 0) {
+			mc_metrics_end(MC_PHASE_LOAD);
+			mc_metrics_begin(MC_PHASE_TYPES);
+			jobs[j].types = mc_registry_cluster_types(desc);
+			mc_metrics_end(MC_PHASE_TYPES);
+			mc_metrics_begin(MC_PHASE_LOAD);
+			if (jobs[j].types == NULL) {
+				printf("Line %li: could not find the clustering types of the motif.\n", jobs[j].line);
+				failed = 1;
+				continue;
+			}
+			jobs[j].realCounts = (long int *)malloc(sizeof(long int)*(jobs[j].types->count+1));
+			jobs[j].typeCounts = (long int *)malloc(sizeof(long int)*(jobs[j].types->count+1)*
+																 (jobs[j].opts.samples+1));
+		}
+		jobs[j].motif = &desc->motif;
+	}
+	mc_metrics_end(MC_PHASE_LOAD);
 	fflush(stdout);
-	ctime_1 = clock();
+	
+	/* One thread creates a task for each job, which adds the tasks of its graph and samples. Idle
+	   threads take on any waiting task, so small jobs fill in around large ones */
+	mc_metrics_begin(MC_PHASE_SAMPLES);
+#ifdef _OPENMP
+#pragma omp parallel num_threads(threads) default(none) private(j) shared(jobs, jobCount, graphs)
+#pragma omp single
 #endif
+	{
+		for (j=0; j<jobCount; j++) {
+			if (jobs[j].motif == NULL) {
+				continue;
+			}
+#ifdef _OPENMP
+#pragma omp task default(none) firstprivate(j) shared(jobs, graphs)
+#endif
+			batch_job_start(&jobs[j], &graphs[jobs[j].graph]);
+		}
+	}
+	mc_metrics_end(MC_PHASE_SAMPLES);
 	
-	/* 2. Find submorphisms between graph and motif */
-	igraph_get_subisomorphisms_vf2(graph, motif, NULL, NULL, NULL, NULL, &maps, NULL, NULL, NULL);
+	/* Free used memory */
+	for (j=0; j<jobCount; j++) {
+		if (jobs[j].status != 0) {
+			failed = 1;
+		}
+		igraph_vector_destroy(&jobs[j].samples);
+		free(jobs[j].realCounts);
+		free(jobs[j].typeCounts);
+	}
+	for (g=0; g<graphCount; g++) {
+		for (t=0; t<threads; t++) {
+			if (graphs[g].ready[t] != 0) {
+				sample_destroy(&graphs[g].workspaces[t]);
+			}
+		}
+		free(graphs[g].workspaces);
+		free(graphs[g].ready);
+		if (graphs[g].loaded != 0) {
+			mc_graph_file_close(&graphs[g].file);
+		}
+	}
+	free(graphs);
+	free(jobs);
 	
+	return failed;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int batch_parse (batch_job_t *job, char *filename, igraph_bool_t *directed, char *line,
+					  unsigned long long seed)
+{
+	const char *args[6];
+	char *token;
+	int positional;
 	
-#ifdef BENCHMARK
-	ctime_2 = clock();
-	printf("All mappings calculated in %f seconds\n", (double)(ctime_2 - ctime_1) / 
-			 (double)CLOCKS_PER_SEC);
-	fflush(stdout);
-	ctime_1 = clock();
-#endif
+	/* Defaults of a single run */
+	job->clusterTypes = 0;
+	job->opts.seed = seed;
+	job->opts.placement = PLACEMENT_SINGLE;
+	job->opts.threads = 1;
+	job->opts.tolerance = 0.0;
+	job->opts.minSamples = 10;
+	job->opts.approxVertices = 0;
+	job->opts.checkpoint = NULL;
+	job->opts.resume = NULL;
+	job->opts.cache = NULL;
+	job->opts.shard = 0;
+	job->opts.shards = 0;
+	job->opts.merge = 0;
+	*directed = 1;
 	
-	mapsCount = (long int)igraph_vector_ptr_size(&maps);	
+	/* Blank and comment lines hold no job */
+	token = strtok(line, " \t\r\n");
+	if (token == NULL || token[0] == '#') {
+		return 2;
+	}
+	if (strcmp(token, "mcc") == 0) {
+		token = strtok(NULL, " \t\r\n");
+	}
+	else if (strcmp(token, "mcstats") == 0 || strcmp(token, "mcextract") == 0) {
+		printf("Line %li: only mcc jobs can be run in a batch.\n", job->line);
+		return 1;
+	}
 	
-	/* Clean up maps list (only required for directed graphs) */
-	if (igraph_is_directed(graph) != 0) {
-		actMaps = 0;
-		motifEdges = igraph_ecount(motif);
-		for (i=0; i<mapsCount; i++) {
-			
-			curi = (igraph_vector_t *)VECTOR(maps)[i];
-			
-			/* Generate a vertex selector from our IDs vector */
-			igraph_vs_vector(&vs, curi);
-			
-			/* Extract the subgraph using this vertex selector */
-			igraph_induced_subgraph(graph, &subGraphs, vs, IGRAPH_SUBGRAPH_CREATE_FROM_SCRATCH);
-			
-			if (igraph_ecount(&subGraphs) != motifEdges) {
-				/* Remove mapping set first value to -1*/
-				VECTOR(*curi)[0] = -1;
+	positional = 0;
+	for (; token != NULL; token = strtok(NULL, " \t\r\n")) {
+		if (strcmp(token, "--undirected") == 0) {
+			*directed = 0;
+		}
+		else if (strcmp(token, "--cluster-types") == 0) {
+			job->clusterTypes = 1;
+		}
+		else if (strcmp(token, "--seed") == 0 && (token = strtok(NULL, " \t\r\n")) != NULL) {
+			job->opts.seed = strtoull(token, NULL, 10);
+		}
+		else if (strcmp(token, "--placement") == 0 && (token = strtok(NULL, " \t\r\n")) != NULL) {
+			if (strcmp(token, "single") == 0) {
+				job->opts.placement = PLACEMENT_SINGLE;
+			}
+			else if (strcmp(token, "batch") == 0) {
+				job->opts.placement = PLACEMENT_BATCH;
 			}
 			else {
-				actMaps++;
+				printf("Line %li: invalid placement, use single or batch.\n", job->line);
+				return 1;
 			}
-			igraph_vs_destroy(&vs);
-			igraph_destroy(&subGraphs);
 		}
+		else if (strncmp(token, "--", 2) == 0) {
+			printf("Line %li: option %s cannot be used in a batch.\n", job->line, token);
+			return 1;
+		}
+		else if (positional < 6) {
+			args[positional++] = token;
+		}
+		else {
+			positional++;
+		}
+	}
+	if (positional != 6) {
+		printf("Line %li: invalid number of arguments.\n", job->line);
+		return 1;
+	}
+	if (strlen(args[0]) >= 1000 || strlen(args[1]) >= 900) {
+		printf("Line %li: file name too long.\n", job->line);
+		return 1;
+	}
+	if (strcmp(args[5], "all") == 0) {
+		printf("Line %li: all motifs at once cannot be run in a batch.\n", job->line);
+		return 1;
+	}
+	strcpy(filename, args[0]);
+	strcpy(job->prefix, args[1]);
+	job->opts.samples = atoi(args[2]);
+	job->opts.trials = atol(args[3]);
+	job->opts.motifId = atoi(args[5]);
+	job->opts.prefix = NULL;
+	job->motifSize = atoi(args[4]);
+	if (job->opts.samples < 0) {
+		printf("Line %li: invalid number of samples.\n", job->line);
+		return 1;
+	}
+	
+	return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void batch_job_start (batch_job_t *job, batch_graph_t *graph)
+{
+	int s;
+	
+	/* The samples need the number of motifs of the graph (found by the counting kernel, which is
+	   quicker than the coefficient) */
+	job->count = motif_count(&graph->file.view, job->motif);
+	job->remaining = job->opts.samples + 1;
+	
+#ifdef _OPENMP
+#pragma omp task default(none) firstprivate(job, graph)
+#endif
+	{
+		if (motif_clustering(&job->mcc, &graph->file.view, job->motif, job->types,
+									job->realCounts, 1) != 0) {
+			job->mcc = -1.0;
+		}
+		batch_task_done(job, graph);
+	}
+	
+	for (s=0; s<job->opts.samples; s++) {
+#ifdef _OPENMP
+#pragma omp task default(none) firstprivate(job, graph, s)
+#endif
+		{
+			batch_sample(job, graph, s);
+			batch_task_done(job, graph);
+		}
+	}
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void batch_sample (batch_job_t *job, batch_graph_t *graph, int s)
+{
+	sample_graph_t *sg;
+	sample_rng_t rng;
+	long int entries;
+	int t, suc;
+	
+	/* Workspace of the thread (tasks stay on the thread that starts them and this one creates no
+	   tasks, so no other sample can use it meanwhile) */
+	t = 0;
+#ifdef _OPENMP
+	t = omp_get_thread_num();
+#endif
+	sg = &graph->workspaces[t];
+	if (graph->ready[t] == 0) {
+		sample_init(sg, graph->file.view.nodes, graph->file.view.directed);
+		graph->ready[t] = 1;
+	}
+	
+	/* Same stream, placement and measurement as a single run of the job */
+	entries = (job->types != NULL) ? job->types->count+1 : 0;
+	sample_rng_seed(&rng, job->opts.seed, (long int)s);
+	suc = calc_sample(sg, job->motif, job->count, job->opts.placement, job->opts.trials, &rng);
+	mc_metrics_add(MC_COUNT_SAMPLES, (suc == 1) ? 0 : 1);
+	mc_metrics_add(MC_COUNT_FAILED, (suc == 1) ? 1 : 0);
+	if (suc == 1) {
+		VECTOR(job->samples)[(long int)s] = -1.0;
 	}
 	else {
-		actMaps = mapsCount;
+		/* A sample without the memory to measure it counts as failed */
+		suc = motif_clustering(&VECTOR(job->samples)[(long int)s], &sg->view, job->motif, job->types,
+									  (job->types != NULL) ? job->typeCounts + s*entries : NULL, 0);
+		if (suc != 0) {
+			VECTOR(job->samples)[(long int)s] = -1.0;
+		}
+	}
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void batch_task_done (batch_job_t *job, batch_graph_t *graph)
+{
+	int left;
+	
+	/* The results of the other tasks are visible to the last one to finish (a sequentially
+	   consistent atomic implies a flush) */
+#ifdef _OPENMP
+#pragma omp atomic capture seq_cst
+#endif
+	left = --job->remaining;
+	if (left == 0) {
+		job->status = batch_output(job, graph);
 	}
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int batch_output (batch_job_t *job, batch_graph_t *graph)
+{
+	char filename[1100];
+	FILE *outFile;
+	double resZScore;
+	long int x, failed, used;
+	int suc;
 	
-#ifdef BENCHMARK
-	ctime_2 = clock();
-	printf("Mappings cleaned up calculated in %f seconds\n", (double)(ctime_2 - ctime_1) / 
-			 (double)CLOCKS_PER_SEC);
-	fflush(stdout);
-	ctime_1 = clock();
+	/* A graph without the memory to find its coefficient has no results */
+	if (job->mcc == -1.0) {
+#ifdef _OPENMP
+#pragma omp critical (output)
 #endif
+		{
+			printf("Line %li (%s): not enough memory to find the motif clustering coefficient.\n",
+					 job->line, job->prefix);
+			fflush(stdout);
+		}
+		return 1;
+	}
+	
+	/* The z-score and type statistics only read the samples vector, which makes no igraph calls */
+	z_score(&resZScore, &used, job->mcc, &job->samples);
+	failed = 0;
+	for (x=0; x<job->opts.samples; x++) {
+		if ((double)VECTOR(job->samples)[x] == -1.0) {
+			failed++;
+		}
+	}
+	suc = 0;
+	if (job->types != NULL && 
+		 cluster_type_stats(job->prefix, job->types, job->realCounts, job->typeCounts, 
+								  &job->samples) != 0) {
+		suc = 1;
+	}
+	
+	/* Output random samples used to calculate z-score */
+	sprintf(filename, "%s_samples.txt", job->prefix);
+	outFile = fopen(filename, "w");
+	if (outFile != NULL) {
+		for (x=0; x<job->opts.samples; x++) {
+			fprintf(outFile, "%.8f\n", (double)VECTOR(job->samples)[x]);
+		}
+		fclose(outFile);
+	}
+	else {
+		suc = 1;
+	}
+	
+	/* Output the statistics from the run */
+	sprintf(filename, "%s_stats.txt", job->prefix);
+	outFile = fopen(filename, "w");
+	if (outFile != NULL) {
+		fprintf(outFile, "Nodes, Edges, MCC, Z-Score, Seed, Samples\n");
+		fprintf(outFile, "%li, %li, %.8f, %.8f, %llu, %li\n", graph->file.view.nodes, 
+				  graph->file.edges, job->mcc, resZScore, job->opts.seed, used);
+		fclose(outFile);
+	}
+	else {
+		suc = 1;
+	}
+	
+	/* Report the job as it completes */
+#ifdef _OPENMP
+#pragma omp critical (output)
+#endif
+	{
+		if (failed > 0) {
+			printf("Line %li: warning, %li random samples could not be generated and are left out "
+					 "of the z-score.\n", job->line, failed);
+		}
+		if (suc != 0) {
+			printf("Line %li: could not write the results to %s.\n", job->line, job->prefix);
+		}
+		printf("Line %li (%s): motif clustering coefficient = %.8f, z-score = %.8f\n", job->line,
+				 job->prefix, job->mcc, resZScore);
+		fflush(stdout);
+	}
 	
-	/* 3. Calculate unique motifs */	
-	return (igraph_integer_t)(actMaps / rotSym);	
+	return suc;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void print_usage (void)
 {
-	printf("mcc FILENAME PREFIX SAMPLE TRIALS MOTIF_SIZE MOTIF_ID\n");
-	printf("    FILENAME   - Graph filename (GML format).\n");
+	printf("mcc FILENAME PREFIX SAMPLE TRIALS MOTIF_SIZE MOTIF_ID [--threads N] [--seed S]\n");
+	printf("    [--tolerance T] [--min-samples N] [--undirected] [--cluster-types] [--approx N]\n");
+	printf("    [--approx-time T] [--placement P] [--checkpoint] [--resume] [--sample-cache DIR]\n");
+	printf("    [--shard I/N|auto] [--merge N] [--metrics FILE]\n");
+	printf("    FILENAME   - Graph filename (GML, binary or edge list format).\n");
 	printf("    PREFIX     - Prefix to use on output files.\n");
 	printf("    SAMPLE     - Size of the sample to generate z-score with.\n");
 	printf("    TRIALS     - Number of trails when placing motifs in random sample.\n");
 	printf("    MOTIF_SIZE - Size of the 1st motif to consider (3 or 4 nodes).\n");
-	printf("    MOTIF_ID   - Isomorphic class ID (from igraph) for the 1st motif.\n");
+	printf("    MOTIF_ID   - Isomorphic class ID (from igraph) for the 1st motif, or \"all\".\n");
+	printf("    --threads N - Number of threads generating the random samples (default 1).\n");
+	printf("    --seed S    - Seed for the random samples (default the current time).\n");
+	printf("    --tolerance T   - Stop once the z-score 95%% interval half width is within T*max(1,|z|).\n");
+	printf("    --min-samples N - Samples generated before stopping early (default 10).\n");
+	printf("    --undirected    - Read an edge list as an undirected graph (default directed).\n");
+	printf("    --cluster-types - Output z-scores of the clustering types to PREFIX_types.txt.\n");
+	printf("    --approx N      - Estimate the coefficients from N vertices, with a 95%% interval.\n");
+	printf("    --approx-time T - Stop drawing vertices for the graph estimate after T seconds.\n");
+	printf("    --placement P   - Place motifs in the samples one at a time (single) or in batches.\n");
+	printf("    --checkpoint    - Append each completed sample to PREFIX_checkpoint.txt.\n");
+	printf("    --resume        - Continue the run in PREFIX_checkpoint.txt, keeping its samples.\n");
+	printf("    --sample-cache DIR - Reuse (or add) the random sample graphs kept in DIR.\n");
+	printf("    --shard I/N     - Only generate shard I of N of the samples into PREFIX_shard_I.txt.\n");
+	printf("    --merge N       - Output the results from the samples of N shards.\n");
+	printf("    --metrics FILE  - Write a JSON report of times, counters and peak memory to FILE.\n");
+	printf("mcc --batch MANIFEST [--threads N] [--seed S] [--metrics FILE]\n");
+	printf("    MANIFEST   - File of jobs, each line holding the arguments of a single run\n");
+	printf("                 (--undirected, --seed, --placement and --cluster-types may be used).\n");
 }
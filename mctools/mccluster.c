@@ -0,0 +1,830 @@
+/*===============================================================================================
+ *  mccluster.c
+ *
+ *  Motif clustering types shared by the mctools command line applications. See mccluster.h for
+ *  details.
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mccluster.h"
+
+/* Magic bytes at the start of a cached catalogue */
+#define MC_TYPES_MAGIC "MCTYPES1"
+
+/* Version of the catalogue files, to be raised whenever the order in which the types are found
+   changes (version 1 files, from before the symmetry pruned search, had no version) */
+#define MC_TYPES_VERSION 2
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Number of edges between a set of union vertices */
+static int mc_union_induced_edges (const mc_union_t *u, const int *set, int n)
+{
+	int i, j, edges;
+
+	edges = 0;
+	for (i=0; i<n; i++) {
+		for (j=0; j<n; j++) {
+			if (i != j && u->adj[set[i]][set[j]] != 0) {
+				edges++;
+			}
+		}
+	}
+	return edges;
+}
+
+/* Add an edge to a union graph unless it is already there */
+static void mc_union_add_edge (mc_union_t *u, igraph_bool_t directed, int from, int to)
+{
+	if (from == to || u->adj[from][to] != 0) {
+		return;
+	}
+	u->adj[from][to] = 1;
+	if (directed == 0) {
+		u->adj[to][from] = 1;
+	}
+	u->edges++;
+}
+
+/* State of the search for the canonical code of a union graph */
+typedef struct {
+	const mc_union_t *u;                      /* Graph being labelled */
+	igraph_bool_t directed;                   /* Whether both entries of a pair are coded */
+	unsigned long long key[MC_MAX_UNION];     /* Invariant of each vertex */
+	unsigned long long sorted[MC_MAX_UNION];  /* Invariants in ascending order */
+	int label[MC_MAX_UNION];                  /* Vertex placed at each position */
+	unsigned char cur[MC_UNION_CODE];         /* Code of the current ordering */
+	mc_union_code_t *best;                    /* Smallest code found so far */
+	long int updates;                         /* Number of times best was replaced */
+} mc_canon_t;
+
+/* Compare two vertex invariants (for qsort) */
+static int mc_compare_key (const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+	return (x > y) - (x < y);
+}
+
+/* Isomorphism invariant of each vertex from its degrees and the degrees of its neighbours */
+static void mc_canon_keys (mc_canon_t *st)
+{
+	unsigned long long deg[MC_MAX_UNION], nb;
+	int i, j, n;
+
+	n = st->u->vertices;
+	for (i=0; i<n; i++) {
+		deg[i] = 0;
+		for (j=0; j<n; j++) {
+			deg[i] += 16*st->u->adj[i][j] + st->u->adj[j][i];
+		}
+	}
+	for (i=0; i<n; i++) {
+		nb = 0;
+		for (j=0; j<n; j++) {
+			if (st->u->adj[i][j] != 0) {
+				nb += (deg[j]+1)*(deg[j]+1)*0x9E3779B1ULL;
+			}
+			if (st->u->adj[j][i] != 0) {
+				nb += (deg[j]+3)*0x85EBCA77ULL;
+			}
+		}
+		st->key[i] = (deg[i] << 40) | (nb & 0xFFFFFFFFFFULL);
+		st->sorted[i] = st->key[i];
+	}
+	qsort(st->sorted, n, sizeof(unsigned long long), mc_compare_key);
+}
+
+/* Place a vertex at position p, the code of the earlier positions being len entries long and
+   equal to the best code if equal is true (smaller otherwise) */
+static void mc_canon_extend (mc_canon_t *st, int p, unsigned int used, igraph_bool_t equal,
+									  int len)
+{
+	int v, q, end, cmp;
+	long int updates;
+
+	for (v=0; v<st->u->vertices; v++) {
+		if (((used >> v) & 1u) != 0 || st->key[v] != st->sorted[p]) {
+			continue;
+		}
+
+		/* Entries between the new vertex and those already placed */
+		st->label[p] = v;
+		end = len;
+		for (q=0; q<p; q++) {
+			st->cur[end++] = st->u->adj[st->label[q]][v];
+			if (st->directed != 0) {
+				st->cur[end++] = st->u->adj[v][st->label[q]];
+			}
+		}
+
+		/* Prune orderings that are already larger than the best */
+		cmp = -1;
+		if (st->updates > 0 && equal != 0) {
+			cmp = memcmp(st->cur + len, st->best->code + len, end - len);
+			if (cmp > 0) {
+				continue;
+			}
+		}
+
+		updates = st->updates;
+		if (p+1 == st->u->vertices) {
+			if (cmp < 0) {
+				memcpy(st->best->code, st->cur, end);
+				st->updates++;
+			}
+		}
+		else {
+			mc_canon_extend(st, p+1, used | (1u << v), (cmp == 0), end);
+		}
+
+		/* A new best code shares this prefix */
+		if (st->updates != updates) {
+			equal = 1;
+		}
+	}
+}
+
+/* Hash of a canonical code (FNV-1a) */
+static unsigned long long mc_code_hash (const mc_union_code_t *c)
+{
+	unsigned long long h;
+	int i;
+
+	h = 14695981039346656037ULL ^ (unsigned long long)c->vertices;
+	h *= 1099511628211ULL;
+	for (i=0; i<c->length; i++) {
+		h ^= c->code[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/* Slot holding a code, or the empty slot where it belongs */
+static long int mc_code_slot (const mc_cluster_types_t *ct, const mc_union_code_t *c)
+{
+	long int s, t;
+
+	s = (long int)(mc_code_hash(c) & (unsigned long long)ct->slotsMask);
+	while ((t = ct->slots[s]) >= 0) {
+		if (ct->codes[t].vertices == c->vertices && ct->codes[t].length == c->length &&
+			 memcmp(ct->codes[t].code, c->code, c->length) == 0) {
+			break;
+		}
+		s = (s + 1) & ct->slotsMask;
+	}
+	return s;
+}
+
+void mc_union_canonical (mc_union_code_t *c, const mc_union_t *u, igraph_bool_t directed)
+{
+	mc_canon_t st;
+
+	c->vertices = u->vertices;
+	c->length = (directed != 0) ? u->vertices*(u->vertices-1) : u->vertices*(u->vertices-1)/2;
+	if (u->vertices == 0) {
+		return;
+	}
+	st.u = u;
+	st.directed = directed;
+	st.best = c;
+	st.updates = 0;
+	mc_canon_keys(&st);
+	mc_canon_extend(&st, 0, 0u, 0, 0);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_union_init (mc_union_t *u, const igraph_t *graph)
+{
+	long int e;
+
+	memset(u, 0, sizeof(mc_union_t));
+	if ((long int)igraph_vcount(graph) > MC_MAX_UNION) {
+		return 1;
+	}
+	u->vertices = (int)igraph_vcount(graph);
+	for (e=0; e<(long int)igraph_ecount(graph); e++) {
+		mc_union_add_edge(u, igraph_is_directed(graph), (int)IGRAPH_FROM(graph, e),
+								(int)IGRAPH_TO(graph, e));
+	}
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_union_graph (igraph_t *graph, const mc_union_t *u, igraph_bool_t directed)
+{
+	igraph_vector_t edges;
+	long int e;
+	int i, j;
+
+	igraph_vector_init(&edges, 2*(long int)u->edges);
+	e = 0;
+	for (i=0; i<u->vertices; i++) {
+		for (j=(directed != 0 ? 0 : i+1); j<u->vertices; j++) {
+			if (u->adj[i][j] != 0) {
+				VECTOR(edges)[e++] = (igraph_real_t)i;
+				VECTOR(edges)[e++] = (igraph_real_t)j;
+			}
+		}
+	}
+	igraph_create(graph, &edges, (igraph_integer_t)u->vertices, directed);
+	igraph_vector_destroy(&edges);
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Next set of n values in [0, size) as an increasing tuple in lexicographic order, returns 0
+   after the last */
+static igraph_bool_t mc_next_set (int *t, int n, int size)
+{
+	int i, j;
+
+	for (i=n-1; i>=0 && t[i] == size-n+i; i--);
+	if (i < 0) {
+		return 0;
+	}
+	t[i]++;
+	for (j=i+1; j<n; j++) {
+		t[j] = t[j-1] + 1;
+	}
+	return 1;
+}
+
+/* Merge two copies of a motif, vertex m2[i] of the second copy being vertex m1[i] of the first,
+   and add the result to the catalogue if both copies are still proper motifs and it is new */
+static int mc_cluster_types_merge (mc_cluster_types_t *ct, const mc_motif_t *m, const int *m1,
+											  const int *m2, int overlap)
+{
+	mc_union_t u;
+	int map[MC_MAX_MOTIF], set[MC_MAX_MOTIF];
+	int i, j, next;
+
+	/* Vertices of the second copy that are not shared follow the first copy in motif order */
+	for (i=0; i<MC_MAX_MOTIF; i++) {
+		map[i] = -1;
+		set[i] = i;
+	}
+	for (i=0; i<overlap; i++) {
+		map[m2[i]] = m1[i];
+	}
+	next = m->size;
+	for (i=0; i<m->size; i++) {
+		if (map[i] < 0) {
+			map[i] = next++;
+		}
+	}
+
+	memset(&u, 0, sizeof(mc_union_t));
+	u.vertices = next;
+	for (i=0; i<m->size; i++) {
+		for (j=0; j<m->size; j++) {
+			if (m->adj[i][j] != 0 && (m->directed != 0 || i < j)) {
+				mc_union_add_edge(&u, m->directed, i, j);
+			}
+		}
+	}
+	for (i=0; i<m->size; i++) {
+		for (j=0; j<m->size; j++) {
+			if (m->adj[i][j] != 0 && (m->directed != 0 || i < j)) {
+				mc_union_add_edge(&u, m->directed, map[i], map[j]);
+			}
+		}
+	}
+
+	/* The merge must not add edges within either copy */
+	j = mc_union_induced_edges(&u, set, m->size);
+	if ((m->directed != 0 ? j : j/2) != m->edges) {
+		return 0;
+	}
+	j = mc_union_induced_edges(&u, map, m->size);
+	if ((m->directed != 0 ? j : j/2) != m->edges) {
+		return 0;
+	}
+
+	/* Keep the type if it is new */
+	return (mc_cluster_types_add(ct, &u) < 0);
+}
+
+/* Search for the ways of merging two copies of a motif. A merge is the partial mapping m1[i] of
+   the first copy <- m2[i] of the second, and both copies remain proper motifs exactly when it is
+   an isomorphism between the subgraphs the shared vertices induce in each copy. Automorphisms of
+   either copy (and reordering the pairs) give merges of the same type, so only the merge that is
+   lexicographically smallest among these is kept: m1 increasing and smallest in its orbit, and m2
+   smallest under the automorphisms of the second copy and those fixing the set m1. As the first
+   merge of each type in the full lexicographic order is such a merge, types are found in the same
+   order as by trying every merge */
+typedef struct {
+	mc_cluster_types_t *ct;             /* Catalogue being built */
+	const mc_motif_t *m;                /* Motif being merged */
+	int overlap;                        /* Number of shared vertices */
+	int m1[MC_MAX_MOTIF];               /* Shared vertices of the first copy (increasing) ... */
+	int m2[MC_MAX_MOTIF];               /* ... and the vertices of the second copy merged with them */
+	int index[MC_MAX_MOTIF];            /* Position of each vertex in m1, -1 if not shared */
+	igraph_bool_t used[MC_MAX_MOTIF];   /* Vertices of the second copy already in m2 */
+	long int *stabiliser;               /* Automorphisms mapping the set m1 onto itself */
+	long int stabiliserCount;           /* Number of them */
+} mc_merge_search_t;
+
+/* Compare tuples lexicographically, returning a negative, zero or positive value */
+static int mc_compare_tuples (const int *t1, const int *t2, int n)
+{
+	int i;
+
+	for (i=0; i<n; i++) {
+		if (t1[i] != t2[i]) {
+			return t1[i] - t2[i];
+		}
+	}
+	return 0;
+}
+
+/* Whether m1 is the smallest set in its orbit, finding the automorphisms that fix it */
+static igraph_bool_t mc_merge_smallest_set (mc_merge_search_t *s)
+{
+	const int *a;
+	int image[MC_MAX_MOTIF], i, j, v, cmp;
+	long int k;
+
+	for (i=0; i<s->m->size; i++) {
+		s->index[i] = -1;
+	}
+	for (i=0; i<s->overlap; i++) {
+		s->index[s->m1[i]] = i;
+	}
+	s->stabiliserCount = 0;
+	for (k=0; k<s->m->automorphisms; k++) {
+		a = s->m->autos + k*s->m->size;
+		for (i=0; i<s->overlap; i++) {
+			v = a[s->m1[i]];
+			for (j=i; j>0 && image[j-1] > v; j--) {
+				image[j] = image[j-1];
+			}
+			image[j] = v;
+		}
+		cmp = mc_compare_tuples(image, s->m1, s->overlap);
+		if (cmp < 0) {
+			return 0;
+		}
+		if (cmp == 0) {
+			s->stabiliser[s->stabiliserCount++] = k;
+		}
+	}
+	return 1;
+}
+
+/* Whether no automorphism of the second copy maps m2[0..n-1] to a smaller tuple */
+static igraph_bool_t mc_merge_smallest_prefix (const mc_merge_search_t *s, int n)
+{
+	const int *b;
+	int image[MC_MAX_MOTIF], i;
+	long int k;
+
+	for (k=1; k<s->m->automorphisms; k++) {
+		b = s->m->autos + k*s->m->size;
+		for (i=0; i<n; i++) {
+			image[i] = b[s->m2[i]];
+		}
+		if (mc_compare_tuples(image, s->m2, n) < 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Whether the merge is the smallest of its type, given m1 is (the pairs m1[i] <- m2[i] become
+   a[m1[i]] <- b[m2[i]], reordered so that the first copy vertices increase again) */
+static igraph_bool_t mc_merge_smallest (const mc_merge_search_t *s)
+{
+	const int *a, *b;
+	int image[MC_MAX_MOTIF], i;
+	long int k, l;
+
+	for (k=0; k<s->stabiliserCount; k++) {
+		a = s->m->autos + s->stabiliser[k]*s->m->size;
+		for (l=0; l<s->m->automorphisms; l++) {
+			b = s->m->autos + l*s->m->size;
+			for (i=0; i<s->overlap; i++) {
+				image[s->index[a[s->m1[i]]]] = b[s->m2[i]];
+			}
+			if (mc_compare_tuples(image, s->m2, s->overlap) < 0) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/* Extend the merge with a vertex of the second copy for m1[d], in increasing order so merges are
+   tried in lexicographic order. Pairs are only added if they keep the mapping an isomorphism */
+static int mc_merge_extend (mc_merge_search_t *s, int d)
+{
+	const mc_motif_t *m;
+	int v, i, ok;
+
+	if (d == s->overlap) {
+		if (mc_merge_smallest(s) == 0) {
+			return 0;
+		}
+		return mc_cluster_types_merge(s->ct, s->m, s->m1, s->m2, s->overlap);
+	}
+
+	m = s->m;
+	for (v=0; v<m->size; v++) {
+		if (s->used[v] != 0) {
+			continue;
+		}
+		ok = 1;
+		for (i=0; i<d && ok != 0; i++) {
+			ok = (m->adj[s->m1[i]][s->m1[d]] == m->adj[s->m2[i]][v] &&
+					m->adj[s->m1[d]][s->m1[i]] == m->adj[v][s->m2[i]]);
+		}
+		if (ok == 0) {
+			continue;
+		}
+		s->m2[d] = v;
+		if (mc_merge_smallest_prefix(s, d+1) != 0) {
+			s->used[v] = 1;
+			if (mc_merge_extend(s, d+1) != 0) {
+				return 1;
+			}
+			s->used[v] = 0;
+		}
+	}
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_cluster_types_init (mc_cluster_types_t *ct, int size, igraph_bool_t directed)
+{
+	ct->size = size;
+	ct->directed = directed;
+	ct->count = 0;
+	ct->capacity = 0;
+	ct->types = NULL;
+	ct->codes = NULL;
+	ct->slots = NULL;
+	ct->slotsMask = -1;
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Add a type with a known canonical code unless it is already held */
+static long int mc_cluster_types_insert (mc_cluster_types_t *ct, const mc_union_t *u,
+													  const mc_union_code_t *c)
+{
+	mc_union_t *types;
+	mc_union_code_t *codes;
+	long int *slots;
+	long int s, t, capacity;
+
+	if (ct->count > 0) {
+		s = mc_code_slot(ct, c);
+		if (ct->slots[s] >= 0) {
+			return ct->slots[s];
+		}
+	}
+
+	/* Grow the types and rebuild the hash table (kept at most half full) */
+	if (ct->count == ct->capacity) {
+		capacity = (ct->capacity == 0) ? 16 : 2*ct->capacity;
+		types = (mc_union_t *)realloc(ct->types, sizeof(mc_union_t)*capacity);
+		if (types != NULL) {
+			ct->types = types;
+		}
+		codes = (mc_union_code_t *)realloc(ct->codes, sizeof(mc_union_code_t)*capacity);
+		if (codes != NULL) {
+			ct->codes = codes;
+		}
+		slots = (long int *)malloc(sizeof(long int)*2*capacity);
+		if (types == NULL || codes == NULL || slots == NULL) {
+			free(slots);
+			return -1;
+		}
+		free(ct->slots);
+		ct->slots = slots;
+		ct->slotsMask = 2*capacity - 1;
+		ct->capacity = capacity;
+		for (s=0; s<=ct->slotsMask; s++) {
+			ct->slots[s] = -1;
+		}
+		for (t=0; t<ct->count; t++) {
+			ct->slots[mc_code_slot(ct, &ct->codes[t])] = t;
+		}
+	}
+
+	t = ct->count;
+	ct->types[t] = *u;
+	ct->codes[t] = *c;
+	ct->slots[mc_code_slot(ct, c)] = t;
+	ct->count++;
+	return t;
+}
+
+long int mc_cluster_types_add (mc_cluster_types_t *ct, const mc_union_t *u)
+{
+	mc_union_code_t c;
+
+	mc_union_canonical(&c, u, ct->directed);
+	return mc_cluster_types_insert(ct, u, &c);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_cluster_types_build (mc_cluster_types_t *ct, const mc_motif_t *m)
+{
+	mc_merge_search_t s;
+	int i, res;
+
+	mc_cluster_types_init(ct, m->size, m->directed);
+	s.stabiliser = (long int *)malloc(sizeof(long int)*m->automorphisms);
+	if (s.stabiliser == NULL) {
+		return 1;
+	}
+	s.ct = ct;
+	s.m = m;
+	for (i=0; i<MC_MAX_MOTIF; i++) {
+		s.used[i] = 0;
+	}
+
+	/* Every set of shared vertices of the first copy, for each overlap size */
+	res = 0;
+	for (s.overlap=1; s.overlap<m->size && res == 0; s.overlap++) {
+		for (i=0; i<s.overlap; i++) {
+			s.m1[i] = i;
+		}
+		do {
+			if (mc_merge_smallest_set(&s) != 0) {
+				res = mc_merge_extend(&s, 0);
+			}
+		} while (res == 0 && mc_next_set(s.m1, s.overlap, m->size) != 0);
+	}
+	free(s.stabiliser);
+	if (res != 0) {
+		mc_cluster_types_destroy(ct);
+	}
+
+	return res;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_cluster_types_write (const mc_cluster_types_t *ct, const char *filename,
+									 unsigned long long code)
+{
+	FILE *out;
+	long int header[6];
+	int res;
+
+	out = fopen(filename, "wb");
+	if (out == NULL) {
+		return 1;
+	}
+	header[0] = MC_TYPES_VERSION;
+	header[1] = (long int)ct->size;
+	header[2] = (long int)ct->directed;
+	header[3] = ct->count;
+	header[4] = (long int)sizeof(mc_union_t);
+	header[5] = (long int)sizeof(mc_union_code_t);
+	res = (fwrite(MC_TYPES_MAGIC, 1, 8, out) != 8 || fwrite(header, sizeof(long int), 6, out) != 6 ||
+			 fwrite(&code, sizeof(unsigned long long), 1, out) != 1 ||
+			 (long int)fwrite(ct->types, sizeof(mc_union_t), ct->count, out) != ct->count ||
+			 (long int)fwrite(ct->codes, sizeof(mc_union_code_t), ct->count, out) != ct->count);
+	if (fclose(out) != 0) {
+		res = 1;
+	}
+	return res;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_cluster_types_read (mc_cluster_types_t *ct, const char *filename, int size,
+									igraph_bool_t directed, unsigned long long code)
+{
+	FILE *in;
+	char magic[8];
+	long int header[6], t;
+	unsigned long long fileCode;
+	mc_union_t *types;
+	mc_union_code_t *codes;
+	int res;
+
+	in = fopen(filename, "rb");
+	if (in == NULL) {
+		return 1;
+	}
+	if (fread(magic, 1, 8, in) != 8 || memcmp(magic, MC_TYPES_MAGIC, 8) != 0 ||
+		 fread(header, sizeof(long int), 6, in) != 6 || header[0] != MC_TYPES_VERSION ||
+		 header[1] != (long int)size || header[2] != (long int)(directed != 0) || header[3] < 0 ||
+		 header[4] != (long int)sizeof(mc_union_t) || header[5] != (long int)sizeof(mc_union_code_t) ||
+		 fread(&fileCode, sizeof(unsigned long long), 1, in) != 1 || fileCode != code) {
+		fclose(in);
+		return 1;
+	}
+
+	/* The types are followed by their codes, which are taken as they are */
+	types = (mc_union_t *)malloc(sizeof(mc_union_t)*(header[3] + 1));
+	codes = (mc_union_code_t *)malloc(sizeof(mc_union_code_t)*(header[3] + 1));
+	res = (types == NULL || codes == NULL ||
+			 (long int)fread(types, sizeof(mc_union_t), header[3], in) != header[3] ||
+			 (long int)fread(codes, sizeof(mc_union_code_t), header[3], in) != header[3]);
+	fclose(in);
+	mc_cluster_types_init(ct, size, directed);
+	for (t=0; t<header[3] && res == 0; t++) {
+		res = (mc_cluster_types_insert(ct, &types[t], &codes[t]) != t);
+	}
+	if (res != 0) {
+		mc_cluster_types_destroy(ct);
+	}
+	free(types);
+	free(codes);
+	return res;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void mc_cluster_types_destroy (mc_cluster_types_t *ct)
+{
+	free(ct->types);
+	free(ct->codes);
+	free(ct->slots);
+	ct->types = NULL;
+	ct->codes = NULL;
+	ct->slots = NULL;
+	ct->slotsMask = -1;
+	ct->count = 0;
+	ct->capacity = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+long int mc_cluster_types_find (const mc_cluster_types_t *ct, const mc_union_t *u)
+{
+	mc_union_code_t c;
+
+	if (ct->count == 0) {
+		return -1;
+	}
+	mc_union_canonical(&c, u, ct->directed);
+	return ct->slots[mc_code_slot(ct, &c)];
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_cluster_union (mc_union_t *u, const mc_graph_t *g, const mc_motif_t *m, const int *m1,
+							 const int *m2)
+{
+	int verts[MC_MAX_UNION];
+	igraph_bool_t in2[MC_MAX_UNION];
+	int i, j, n;
+
+	/* Vertices of the second instance not in the first are added in its motif order */
+	n = m->size;
+	for (i=0; i<m->size; i++) {
+		verts[i] = m1[i];
+		in2[i] = 0;
+	}
+	for (i=0; i<m->size; i++) {
+		for (j=0; j<m->size; j++) {
+			if (m2[i] == m1[j]) {
+				in2[j] = 1;
+				break;
+			}
+		}
+		if (j == m->size) {
+			verts[n] = m2[i];
+			in2[n] = 1;
+			n++;
+		}
+	}
+	if (n == 2*m->size) {
+		return 1;
+	}
+
+	memset(u, 0, sizeof(mc_union_t));
+	u->vertices = n;
+	for (i=0; i<m->size; i++) {
+		for (j=0; j<m->size; j++) {
+			if (m->adj[i][j] != 0 && (m->directed != 0 || i < j)) {
+				mc_union_add_edge(u, m->directed, i, j);
+			}
+		}
+	}
+
+	/* Graph edges at the new vertices within the second instance */
+	for (i=m->size; i<n; i++) {
+		for (j=0; j<n; j++) {
+			if (j == i || in2[j] == 0) {
+				continue;
+			}
+			if (mc_graph_has_edge(g, verts[i], verts[j]) != 0) {
+				mc_union_add_edge(u, g->directed, i, j);
+			}
+			if (g->directed != 0 && mc_graph_has_edge(g, verts[j], verts[i]) != 0) {
+				mc_union_add_edge(u, g->directed, j, i);
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_cluster_census (long int *counts, const mc_cluster_types_t *ct, const mc_graph_t *g,
+							  const mc_motif_t *m, const mc_overlap_t *ov)
+{
+	long int i, j, k, v, p, t, kept, overlapping, touchedCount;
+	long int *touched;
+	unsigned char *hits, *dup;
+	mc_union_t u;
+
+	for (t=0; t<=ct->count; t++) {
+		counts[t] = 0;
+	}
+	if (ov->count == 0) {
+		return 0;
+	}
+
+	touched = (long int *)malloc(sizeof(long int)*ov->count);
+	hits = (unsigned char *)calloc(ov->count, sizeof(unsigned char));
+	dup = (unsigned char *)calloc(ov->count, sizeof(unsigned char));
+	if (touched == NULL || hits == NULL || dup == NULL) {
+		free(touched);
+		free(hits);
+		free(dup);
+		return 1;
+	}
+
+	/* Only the first instance with each vertex set is used, a later one with the same set must
+	   be in the list of each of its vertices */
+	kept = 0;
+	for (i=0; i<ov->count; i++) {
+		v = ov->verts[i*ov->size];
+		for (p=ov->offsets[v]; p<ov->offsets[v+1] && ov->insts[p] < i; p++) {
+			j = ov->insts[p];
+			for (k=1; k<ov->size; k++) {
+				for (t=0; t<ov->size; t++) {
+					if (ov->verts[j*ov->size + t] == ov->verts[i*ov->size + k]) {
+						break;
+					}
+				}
+				if (t == ov->size) {
+					break;
+				}
+			}
+			if (k == ov->size) {
+				dup[i] = 1;
+				break;
+			}
+		}
+		if (dup[i] == 0) {
+			kept++;
+		}
+	}
+
+	/* Classify each pair of instances that share a vertex */
+	overlapping = 0;
+	for (i=0; i<ov->count; i++) {
+		if (dup[i] != 0) {
+			continue;
+		}
+		touchedCount = mc_overlap_partners(ov, i, touched, hits);
+		for (p=0; p<touchedCount; p++) {
+			j = touched[p];
+			if (dup[j] != 0) {
+				continue;
+			}
+			overlapping++;
+			mc_cluster_union(&u, g, m, ov->verts + i*ov->size, ov->verts + j*ov->size);
+			t = mc_cluster_types_find(ct, &u);
+			if (t >= 0) {
+				counts[t]++;
+			}
+		}
+	}
+
+	/* Every other pair shares no vertex */
+	counts[ct->count] = kept*(kept-1)/2 - overlapping;
+
+	free(touched);
+	free(hits);
+	free(dup);
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
@@ -0,0 +1,128 @@
+/*===============================================================================================
+ *  mccluster.h
+ *
+ *  Motif clustering types shared by the mctools command line applications. A clustering type is
+ *  a way in which two instances of a motif can share vertices, as counted by mcstats: the union
+ *  of two copies of the motif overlapping in 1 to size-1 vertices such that both copies remain
+ *  proper motifs. Pairs of motif instances in a graph are classified by building their union
+ *  and looking up its canonical code in a hash table of the codes of the types, so each pair
+ *  costs one canonical labelling rather than an isomorphism test against every type. Apart from
+ *  mc_union_init and mc_union_graph only plain memory is used (no igraph calls) so pairs can be
+ *  classified from several threads. Compile mccluster.c and mcmotif.c alongside the application,
+ *  e.g.
+ *
+ *     gcc -I INC_DIR -L LIB_DIR -O3 mcc.c mcmotif.c mcgraph.c mccluster.c -ligraph -lstdc++ -o mcc
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#ifndef MCCLUSTER_H
+#define MCCLUSTER_H
+
+#include <igraph.h>
+#include "mcmotif.h"
+
+/* Largest union of two overlapping motifs */
+#define MC_MAX_UNION (2*MC_MAX_MOTIF-1)
+
+/* Longest canonical code of a union (one entry per ordered vertex pair) */
+#define MC_UNION_CODE (MC_MAX_UNION*(MC_MAX_UNION-1))
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Small simple graph holding the union of two motif instances (or a clustering type). */
+typedef struct {
+	int vertices;                                  /* Number of vertices */
+	int edges;                                     /* Number of edges */
+	unsigned char adj[MC_MAX_UNION][MC_MAX_UNION]; /* Adjacency matrix (adj[i][j] for i -> j) */
+} mc_union_t;
+
+/* Canonical code of a union graph: its adjacency entries in the order of the isoclass codes of
+ * mcmotif.h ((0,1), (1,0), (0,2), (2,0), (1,2), ... with a single entry per pair for undirected
+ * graphs) for the vertex ordering that makes them smallest. Only orderings that sort the vertices
+ * by an isomorphism invariant (their degrees and those of their neighbours) are searched, with
+ * orderings pruned as soon as their prefix is larger than the best so far. Two union graphs are
+ * isomorphic exactly when their codes are the same. */
+typedef struct {
+	int vertices;                       /* Number of vertices */
+	int length;                         /* Number of code entries */
+	unsigned char code[MC_UNION_CODE];  /* Adjacency entries */
+} mc_union_code_t;
+
+/* Build the union graph of an igraph graph, returns 1 if it has too many vertices. */
+int mc_union_init (mc_union_t *u, const igraph_t *graph);
+
+/* Create an igraph graph of a union graph (for output), edges ordered by their end vertices. */
+int mc_union_graph (igraph_t *graph, const mc_union_t *u, igraph_bool_t directed);
+
+/* Compute the canonical code of a union graph. */
+void mc_union_canonical (mc_union_code_t *c, const mc_union_t *u, igraph_bool_t directed);
+
+/* Catalogue of the clustering types of a motif, numbered (from 0) in the order mcstats finds
+ * them: by the number of shared vertices and then the overlap mappings of the two copies. The
+ * types are indexed by their canonical codes. */
+typedef struct {
+	int size;                /* Size of the motif */
+	igraph_bool_t directed;  /* Directedness of the motif */
+	long int count;          /* Number of clustering types */
+	long int capacity;       /* Room allocated for types */
+	mc_union_t *types;       /* Union graph of each type */
+	mc_union_code_t *codes;  /* Canonical code of each type */
+	long int *slots;         /* Hash table of types by code (-1 for empty slots) */
+	long int slotsMask;      /* Number of slots minus one (a power of two) */
+} mc_cluster_types_t;
+
+/* Initialise an empty catalogue for motifs of a size. */
+int mc_cluster_types_init (mc_cluster_types_t *ct, int size, igraph_bool_t directed);
+
+/* Add a clustering type unless an isomorphic one is already held. Returns the index of the type,
+ * -1 on failure. */
+long int mc_cluster_types_add (mc_cluster_types_t *ct, const mc_union_t *u);
+
+/* Initialise the catalogue with the clustering types of a motif. The overlaps of the two copies
+ * are found by a search that only extends mappings of shared vertices which keep both copies
+ * proper motifs, and only tries one mapping of each set that the automorphisms of the motif
+ * make equivalent, so motifs of 5 or more vertices are handled quickly. */
+int mc_cluster_types_build (mc_cluster_types_t *ct, const mc_motif_t *m);
+
+/* Write the catalogue of the motif with an adjacency code (see mc_registry_code) to a file in
+ * native binary form (e.g. to cache it between runs), with the version of the format. */
+int mc_cluster_types_write (const mc_cluster_types_t *ct, const char *filename,
+									 unsigned long long code);
+
+/* Read a catalogue written by mc_cluster_types_write for the motif of a size, directedness and
+ * adjacency code. Returns 1 if the file is missing or does not hold such a catalogue, including
+ * files of another version of the format (whose types may be numbered differently). */
+int mc_cluster_types_read (mc_cluster_types_t *ct, const char *filename, int size,
+									igraph_bool_t directed, unsigned long long code);
+
+/* Free memory used by the catalogue. */
+void mc_cluster_types_destroy (mc_cluster_types_t *ct);
+
+/* Clustering type isomorphic to a union graph, -1 if there is none. */
+long int mc_cluster_types_find (const mc_cluster_types_t *ct, const mc_union_t *u);
+
+/* Build the union of two motif instances (mappings of motif vertex -> graph vertex) as mcstats
+ * does: the motif edges of the first instance, plus the graph edges between each vertex only in
+ * the second instance and the other vertices of the second instance. The first instance takes
+ * union vertices 0..size-1 in motif order. Returns 1 if the instances share no vertex. */
+int mc_cluster_union (mc_union_t *u, const mc_graph_t *g, const mc_motif_t *m, const int *m1,
+							 const int *m2);
+
+/* Count the pairs of motif instances of each clustering type, matching mcstats. The instances are
+ * those of a built overlap index, of which only the first with each vertex set is used. Pairs
+ * sharing vertices are found through the index and counts needs count+1 entries, the last one
+ * being the pairs that share no vertex. Overlapping pairs that match no type are not counted. */
+int mc_cluster_census (long int *counts, const mc_cluster_types_t *ct, const mc_graph_t *g,
+							  const mc_motif_t *m, const mc_overlap_t *ov);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,113 @@
+/*===============================================================================================
+ *  mcconvert.c
+ *
+ *  Converts a GML graph or an edge list to the binary graph format read by mcc, mcstats and
+ *  mcextract (see mcgraph.h). Binary graphs are memory mapped when loaded, which avoids parsing
+ *  the input for every run. The original node IDs of the input are kept.
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  To compile use the following command:
+ *
+ *     gcc -I INC_DIR -L LIB_DIR -O3 mcconvert.c mcmotif.c mcgraph.c -ligraph -lstdc++ -o mcconvert
+ *
+ *  where INC_DIR is the include directory and LIB_DIR is the library directory. The igraph
+ *  library is required to compile this program and can be found at http://igraph.sourceforge.net/
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Usage:
+ *
+ *     mcconvert GRAPH_IN GRAPH_OUT [--undirected]
+ *
+ *     GRAPH_IN:    Input graph (GML or edge list format).
+ *     GRAPH_OUT:   File to output the graph to (binary format).
+ *     --undirected Read an edge list as an undirected graph (default directed).
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#include <igraph.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mcmotif.h"
+#include "mcgraph.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Function prototypes */
+void print_usage (void);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Main function */
+int main (int argc, const char * argv[])
+{
+	mc_graph_file_t gf;
+	igraph_bool_t directed;
+	const char *args[2];
+	int a, positional, res;
+
+	/* Check that there are enough arguments */
+	if (argc == 2 && strcmp(argv[1], "-h") == 0) {
+		print_usage();
+		return 0;
+	}
+	directed = 1;
+	positional = 0;
+	for (a=1; a<argc; a++) {
+		if (strcmp(argv[a], "--undirected") == 0) {
+			directed = 0;
+		}
+		else if (positional < 2) {
+			args[positional++] = argv[a];
+		}
+		else {
+			positional++;
+		}
+	}
+	if (positional != 2) {
+		printf("Invalid number of arguments.\n");
+		return 1;
+	}
+
+	/* Load the graph in any format with its original node IDs (the id attribute of GML nodes), so
+	   the binary file reports the same IDs as its input */
+	if (mc_graph_file_open(&gf, args[0], directed) != 0) {
+		printf("Could not read graph from %s.\n", args[0]);
+		return 1;
+	}
+
+	/* Write the adjacency lists */
+	res = mc_graph_file_write(args[1], &gf.view, gf.edges, gf.ids);
+	if (res != 0) {
+		printf("Could not write %s.\n", args[1]);
+	}
+	else {
+		printf("Converted graph with %li nodes and %li edges.\n", gf.view.nodes, gf.edges);
+	}
+
+	/* Free used memory and return */
+	mc_graph_file_close(&gf);
+	return res;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Print usage information */
+void print_usage (void)
+{
+	printf("mcconvert GRAPH_IN GRAPH_OUT [--undirected]\n");
+	printf("  GRAPH_IN   - Input graph (GML or edge list format)\n");
+	printf("  GRAPH_OUT  - File to output the graph to (binary format)\n");
+	printf("  --undirected - Read an edge list as an undirected graph (default directed)\n");
+}
+
+/* ---------------------------------------------------------------------------------------------- */
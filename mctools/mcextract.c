@@ -9,7 +9,8 @@
  *
  *  To compile use the following command:
  *
- *     gcc -I INC_DIR -L LIB_DIR -O3 mcextract.c -ligraph -lstdc++ -o mcextract
+ *     gcc -I INC_DIR -L LIB_DIR -O3 mcextract.c mcmotif.c mcgraph.c mcmetrics.c -ligraph -lstdc++
+ *         -o mcextract
  *
  *  where INC_DIR is the include directory and LIB_DIR is the library directory. The igraph
  *  library is required to compile this program and can be found at http://igraph.sourceforge.net/
@@ -18,13 +19,18 @@
  *
  *  Usage:
  *
- *     mcextract GRAPH_IN MOTIF_SIZE MOTIF_ID GRAPH_OUT [MAP_OUT]
+ *     mcextract GRAPH_IN MOTIF_SIZE MOTIF_ID GRAPH_OUT [MAP_OUT] [--undirected] [--metrics FILE]
  *
- *     GRAPH_IN:    GML format file of input graph.
+ *     GRAPH_IN:    Input graph (GML, binary or edge list format, see mcgraph.h).
  *     MOTIF_SIZE:  Size of the motifs to consider.
  *     MOTIF_ID:    The isomorphic class of the 1st motif.
  *     GRAPH_OUT:   File to output the subgraph to (GML format).
- *     MAP_OUT:     File containing mappings of in node -> out node (optional)
+ *     MAP_OUT:     File containing mappings of in node -> out node (optional). Input nodes are
+ *                  given by their original IDs (the id attribute of GML nodes).
+ *     --undirected Read an edge list as an undirected graph (default directed).
+ *     --metrics FILE Write a JSON report of the run to FILE (see mcmetrics.h): the wall and CPU
+ *                  time of loading, finding the motifs and the output, peak memory and counters
+ *                  of the mappings and instances found.
  *
  *------------------------------------------------------------------------------------------------
  *
@@ -39,6 +45,9 @@
 #include <igraph.h>
 #include <stdlib.h>
 #include <string.h>
+#include "mcmotif.h"
+#include "mcgraph.h"
+#include "mcmetrics.h"
 
 #define TRUE -1
 #define FALSE 0
@@ -46,233 +55,251 @@
 /* ---------------------------------------------------------------------------------------------- */
 
 /* Function prototypes */
-int  motif_extract (const igraph_t *G, igraph_t *res, igraph_t *M, igraph_vector_t *nMaps);
+int  motif_extract (mc_graph_t *gView, igraph_t *res, igraph_t *M, igraph_vector_t *nMaps);
+igraph_bool_t add_motif (const int *map, void *arg);
 void print_usage   (void);
 
+/* Collects the unique motif mappings as they are found by the enumeration */
+typedef struct {
+	mc_graph_t *view;            /* Graph being searched */
+	mc_motif_t *motif;           /* Motif being extracted */
+	long int mapsCount;          /* Number of mappings visited */
+	long int rejected;           /* Number of mappings that are not proper motifs */
+	mc_overlap_t maps;           /* Unique proper motif mappings (rows of motif size node IDs) */
+	igraph_bool_t failed;        /* Set if memory ran out */
+	mc_vertex_sets_t sets;       /* Vertex sets of the mappings held */
+} extract_visit_t;
+
 /* ---------------------------------------------------------------------------------------------- */
 
 /* Main function */
 int main (int argc, const char * argv[])
 {
 	igraph_integer_t i;
-	FILE *gFile, *sFile;
-	igraph_t G, subgraphs, M;
+	FILE *sFile;
+	igraph_t subgraphs, M;
+	mc_graph_file_t G;
 	igraph_vector_t motifs, nMaps;
-	igraph_vector_init(&motifs, 0);
+	long int v;
+	igraph_bool_t directed;
+	const char *args[5];
+	int a, positional;
+	const char *metrics;
 	
 	/* Check that there are enough arguments */	
 	if (argc == 2 && strcmp(argv[1], "-h") == 0) {
 		print_usage();
 		return 0;
 	}
-	if (argc < 5 || argc > 6) {
+	
+	/* Separate the options from the positional arguments */
+	directed = 1;
+	metrics = NULL;
+	positional = 0;
+	for (a=1; a<argc; a++) {
+		if (strcmp(argv[a], "--undirected") == 0) {
+			directed = 0;
+		}
+		else if (strcmp(argv[a], "--metrics") == 0 && a+1 < argc) {
+			metrics = argv[++a];
+		}
+		else if (positional < 5) {
+			args[positional++] = argv[a];
+		}
+		else {
+			positional++;
+		}
+	}
+	if (positional < 4 || positional > 5) {
 		printf("Invalid number of arguments.\n");
 		return 1;
 	}
 	
-	/* Load the user specified topology (GML Format) */
-	gFile = fopen(argv[1], "r");
-	igraph_read_graph_gml(&G, gFile);
-	fclose(gFile);
+	/* Load the user specified topology (any format, see mcgraph.h) */
+	if (metrics != NULL) {
+		mc_metrics_enable();
+	}
+	mc_metrics_begin(MC_PHASE_LOAD);
+	if (mc_graph_file_open(&G, args[0], directed) != 0) {
+		printf("Could not read graph from %s.\n", args[0]);
+		return 1;
+	}
+	mc_metrics_end(MC_PHASE_LOAD);
 	
 	/* Place motifs from command line into vector */
-	igraph_vector_push_back(&motifs, atoi(argv[3]));
+	igraph_vector_init(&motifs, 0);
+	igraph_vector_push_back(&motifs, atoi(args[2]));
 	
 	/* Generate a graph of the motif we are interested in - use isomorphic class ID */
-	igraph_isoclass_create(&M, atoi(argv[2]), atoi(argv[3]), igraph_is_directed(&G));
+	igraph_isoclass_create(&M, atoi(args[1]), atoi(args[2]), G.view.directed);
 	
 	/* Extract the subgraph */
-	motif_extract (&G, &subgraphs, &M, &nMaps);
+	motif_extract (&G.view, &subgraphs, &M, &nMaps);
 
 	/* Write extracted subgraph to file */
-	sFile = fopen(argv[4], "w");
+	mc_metrics_begin(MC_PHASE_OUTPUT);
+	sFile = fopen(args[3], "w");
 	igraph_write_graph_gml(&subgraphs, sFile, NULL, NULL);
 	fclose(sFile);
 	
-	/* Output node mappings to original graph */
-	if (argc == 6) {
-		sFile = fopen(argv[5], "w");
+	/* Output node mappings to original graph (using the original node IDs) */
+	if (positional == 5) {
+		sFile = fopen(args[4], "w");
 		for (i=0; i<igraph_vector_size(&nMaps); i++) {
-			fprintf(sFile, "%li,%li\n", (long int)i, (long int)VECTOR(nMaps)[(long int)i]);
+			v = (long int)VECTOR(nMaps)[(long int)i];
+			fprintf(sFile, "%li,%lli\n", (long int)i, (G.ids != NULL) ? G.ids[v] : (long long)v);
 		}
 		fclose(sFile);
 	}
+	mc_metrics_end(MC_PHASE_OUTPUT);
+	if (metrics != NULL && mc_metrics_write(metrics, "mcextract", argc, argv) != 0) {
+		printf("Could not write the metrics to %s.\n", metrics);
+	}
 	
 	/* Free used memory and return */
 	igraph_vector_destroy(&nMaps);
-	igraph_destroy(&G);
+	mc_graph_file_close(&G);
 	igraph_destroy(&subgraphs);
+	igraph_destroy(&M);
+	igraph_vector_destroy(&motifs);
 	return 0;
 }
 
 /* ---------------------------------------------------------------------------------------------- */
 
-/* Extract the required motifs from the graph  */
-int motif_extract (const igraph_t *G, igraph_t *outG, igraph_t *M, igraph_vector_t *nMaps)
+/* Extract the required motifs from the view of the graph  */
+int motif_extract (mc_graph_t *gView, igraph_t *outG, igraph_t *M, igraph_vector_t *nMaps)
 {
-	igraph_integer_t i, j, s, t, mapsCount, actMapsCount, count, found, mSize;
-	igraph_vector_t *curMap, *curAllMap;
-	igraph_t subGraph;
-	igraph_vs_t vs;
-	igraph_vector_ptr_t cTypes, maps, actMaps;
-	igraph_vector_ptr_init(&maps, 0);
-	igraph_vector_ptr_init(&cTypes, 0);
-	mSize = igraph_vcount(M);
-	
-	igraph_integer_t toAdd, eid;
-	long int nID;
-	igraph_bool_t sRes;
-	igraph_vector_t newMap;
-	igraph_es_t es;
-	igraph_eit_t eit;
-	
-	igraph_empty(outG, 0, igraph_is_directed(G));
-	
+	long int i, j, v, used;
+	int *newIds, *map;
+	igraph_vector_t edges;
+	mc_motif_t motif;
+	extract_visit_t visit;
 	
 #ifdef DEBUG
 	printf("Finding motifs in graph.\n");
 	fflush(stdout);
 #endif
 	
-	/* Find submorphisms between graph and motif */
-	igraph_get_subisomorphisms_vf2(G, M, NULL, NULL, NULL, NULL, &maps, NULL, NULL, NULL);
+	/* Phase one: find one mapping between graph and motif for each motif instance, each is
+	   cleaned up and kept only if it is a new proper motif */
+	mc_metrics_begin(MC_PHASE_MOTIFS);
+	mc_motif_init(&motif, M);
+	visit.view = gView;
+	visit.motif = &motif;
+	visit.mapsCount = 0;
+	visit.rejected = 0;
+	mc_overlap_init(&visit.maps, (long int)motif.size, gView->nodes);
+	visit.failed = 0;
+	mc_vertex_sets_init(&visit.sets, motif.size, gView->nodes);
+	mc_motif_enumerate(gView, &motif, 1, add_motif, &visit);
+	mc_vertex_sets_destroy(&visit.sets);
+	mc_metrics_add(MC_COUNT_MAPPINGS, visit.mapsCount);
+	mc_metrics_add(MC_COUNT_REJECTED, visit.rejected);
+	mc_metrics_add(MC_COUNT_INSTANCES, visit.maps.count);
 	
 #ifdef DEBUG
-	printf("Cleaning up motif mappings.\n");
+	printf("Found %li actual motif mappings in graph.\n", visit.maps.count);
 	fflush(stdout);
 #endif
 	
-	/* Clean up maps list (only required for directed graphs) */
-	if (igraph_is_directed(G) != 0) {
-		for (i=0; i<igraph_vector_ptr_size(&maps); i++) {
-			curMap = (igraph_vector_t *)VECTOR(maps)[(long int)i];
-			/* Generate a vertex selector from our IDs vector */
-			igraph_vs_vector(&vs, curMap);
-			/* Extract the subgraph using this vertex selector */
-			igraph_induced_subgraph(G, &subGraph, vs, IGRAPH_SUBGRAPH_CREATE_FROM_SCRATCH);
-			/* Check to see if the motif is missing edges from original graph => not proper motif */
-			if (igraph_ecount(&subGraph) != igraph_vcount(M)) {
-				/* Remove mapping set first value to -1*/
-				VECTOR(*curMap)[0] = -1;
-			}
-			/* Free used memory */
-			igraph_vs_destroy(&vs);
-			igraph_destroy(&subGraph);
+	/* Phase two: number the nodes of the motifs in the order they are first found, which gives
+	   the mapping from our new node ID to the old ones in G, and create the subgraph from the
+	   edges of all the motifs at once (so we only include edges of the motifs) */
+	newIds = (int *)malloc(sizeof(int)*(gView->nodes + 1));
+	if (newIds == NULL || visit.failed != 0) {
+		printf("Error: not enough memory to extract the motifs\n");
+		free(newIds);
+		mc_overlap_destroy(&visit.maps);
+		mc_motif_destroy(&motif);
+		igraph_empty(outG, 0, gView->directed);
+		igraph_vector_init(nMaps, 0);
+		return 1;
+	}
+	for (v=0; v<gView->nodes; v++) {
+		newIds[v] = -1;
+	}
+	used = 0;
+	for (i=0; i<visit.maps.count*motif.size; i++) {
+		if (newIds[visit.maps.verts[i]] < 0) {
+			newIds[visit.maps.verts[i]] = (int)used++;
 		}
 	}
-	
-	/* Keep track of the unique motifs found so far */
-	mapsCount = igraph_vector_ptr_size(&maps);
-	actMapsCount = 0;
-	
-	/* Somewhere to hold the actual motifs, resize later once the actual number is known */
-	igraph_vector_ptr_init(&actMaps, mapsCount);
-	
-	/* Go through the whole list and add if not found already */
-	for (i=0; i<mapsCount; i++) {
-		curAllMap = (igraph_vector_t *)VECTOR(maps)[(long int)i];
-		if (VECTOR(*curAllMap)[0] != -1) {
-			
-			found = 0;
-			for (j=0; j<actMapsCount; j++) {
-				curMap = (igraph_vector_t *)VECTOR(actMaps)[(long int)j];
-				/* Loop through both vectors and see if matching elements are found */
-				count = 0;
-				for (s=0; s<igraph_vcount(M); s++) {
-					for (t=0; t<igraph_vcount(M); t++) {
-						if (VECTOR(*curAllMap)[(long int)s] == VECTOR(*curMap)[(long int)t]) {
-							count++;
-							break;
-						}
-					}
-				}
-				if (count == igraph_vcount(M)) {
-					/* Found the motif, break and do not add */
-					found = 1;
-					break;
-				}
-			}
-			if (found == 0) {
-				/* New motif so add */
-				VECTOR(actMaps)[(long int)actMapsCount] = curAllMap;
-				actMapsCount++;
-			}
-			
+	igraph_vector_init(nMaps, used);
+	for (v=0; v<gView->nodes; v++) {
+		if (newIds[v] >= 0) {
+			VECTOR(*nMaps)[newIds[v]] = (igraph_real_t)v;
 		}
 	}
-	
-#ifdef DEBUG
-	printf("Found %li actual motif mappings in graph.\n", (long int)actMapsCount);
-	fflush(stdout);
-#endif
-	
-	/* Resize to the actual count number */
-	igraph_vector_ptr_resize(&actMaps, actMapsCount);
-	
-	/* This holds the mappings from our new node ID to the old ones in G */
-	igraph_vector_init(nMaps, 0);
-	
-	/* Some variable for holding and adding nodes and mappings */
-	igraph_vector_init(&newMap, mSize);
-	es = igraph_ess_all(IGRAPH_EDGEORDER_ID);
-	igraph_eit_create(M, es, &eit);
-	
-	/* To ensure we only include edges of the motifs we grow the graph one motif at a time */
-	for (i=0; i<igraph_vector_ptr_size(&actMaps); i++) {
-		
-		curMap = (igraph_vector_t *)VECTOR(actMaps)[(long int)i];
-		toAdd = 0;
-		
-		/* Calculate mapping for current motif */
-		for (j=0; j<mSize; j++) {
-			sRes = igraph_vector_search(nMaps, 0, (igraph_real_t)VECTOR(*curMap)[(long int)j], &nID);
-			if ((long int)sRes != FALSE) {
-				/* Node already exists so take ID from the mapping list */
-				VECTOR(newMap)[(long int)j] = (igraph_real_t)nID;
-			}
-			else {
-				/* Need to add a new node to mapping list so use the new ID */
-				VECTOR(newMap)[(long int)j] = igraph_vector_size(nMaps);
-				igraph_vector_push_back(nMaps, (igraph_real_t)VECTOR(*curMap)[(long int)j]);
-				toAdd++;
-			}
+	igraph_vector_init(&edges, 2*visit.maps.count*motif.edges);
+	for (i=0; i<visit.maps.count; i++) {
+		map = visit.maps.verts + i*motif.size;
+		for (j=0; j<motif.edges; j++) {
+			VECTOR(edges)[2*(i*motif.edges + j)] = (igraph_real_t)newIds[map[motif.from[j]]];
+			VECTOR(edges)[2*(i*motif.edges + j)+1] = (igraph_real_t)newIds[map[motif.to[j]]];
 		}
-		
-		/* Add missing nodes */
-		igraph_add_vertices(outG, toAdd, (void *)0);
-		
-		/* Iterate through motifs edges using mapping to add edges to growing graph */
-		IGRAPH_EIT_RESET(eit);
-		do {
-			/* Find the mapping */
-			eid = IGRAPH_EIT_GET(eit);		
-			igraph_add_edge(outG, (igraph_integer_t)VECTOR(newMap)[(long int)IGRAPH_FROM(M, eid)], 
-										 (igraph_integer_t)VECTOR(newMap)[(long int)IGRAPH_TO(M, eid)]);
-
-			
-			IGRAPH_EIT_NEXT(eit);
-		} while (!IGRAPH_EIT_END(eit));
 	}
-	igraph_eit_destroy(&eit);
+	igraph_create(outG, &edges, (igraph_integer_t)used, gView->directed);
 	
 	/* Remove any duplicate edges */
 	igraph_simplify(outG, -1, -1, 0);
+	mc_metrics_end(MC_PHASE_MOTIFS);
 	
 	/* Free used memory */
-	igraph_vs_destroy(&vs);
+	igraph_vector_destroy(&edges);
+	free(newIds);
+	mc_overlap_destroy(&visit.maps);
+	mc_motif_destroy(&motif);
 	
 	return 0;
 }
 
 /* ---------------------------------------------------------------------------------------------- */
 
+/* Visitor for the motif enumeration - keeps the mapping if it is a new proper motif */
+igraph_bool_t add_motif (const int *map, void *arg)
+{
+	extract_visit_t *visit = (extract_visit_t *)arg;
+	int res;
+	
+	visit->mapsCount++;
+	
+	/* Clean up mapping (only required for directed graphs) */
+	if (visit->view->directed != 0 && mc_motif_induced(visit->view, visit->motif, map) == 0) {
+		/* Not a proper motif */
+		visit->rejected++;
+		return 1;
+	}
+	
+	/* Check the mapping against those already added (by its vertex set) */
+	res = mc_vertex_sets_add(&visit->sets, map);
+	if (res == 0) {
+		/* Found the motif, do not add */
+		return 1;
+	}
+	
+	/* New motif so keep a copy */
+	if (res < 0 || mc_overlap_add(&visit->maps, map) != 0) {
+		/* Out of memory, stop the enumeration */
+		visit->failed = 1;
+		return 0;
+	}
+	
+	return 1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
 /* Print usage information */
 void print_usage (void)
 {
-	printf("mcextract GRAPH_IN MOTIF_SIZE MOTIF_ID GRAPH_OUT [MAP_OUT]\n");
-	printf("  GRAPH_IN   - GML format file of input graph\n");
+	printf("mcextract GRAPH_IN MOTIF_SIZE MOTIF_ID GRAPH_OUT [MAP_OUT] [--undirected]\n");
+	printf("          [--metrics FILE]\n");
+	printf("  GRAPH_IN   - Input graph (GML, binary or edge list format)\n");
 	printf("  MOTIF_SIZE - Size of the motif to consider\n");
 	printf("  MOTIF_ID   - The isomorphic class of the motif to extract\n");
 	printf("  GRAPH_OUT  - File to output the subgraph to (GML format)\n");
 	printf("  MAP_OUT    - File containing mappings of in node -> out node (optional)\n");
+	printf("  --undirected - Read an edge list as an undirected graph (default directed)\n");
+	printf("  --metrics FILE - Write a JSON report of times, counters and peak memory to FILE\n");
 }
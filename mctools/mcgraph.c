@@ -0,0 +1,691 @@
+/*===============================================================================================
+ *  mcgraph.c
+ *
+ *  Graph input shared by the mctools command line applications (see mcgraph.h).
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mcgraph.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Round a length up to the 8 byte alignment of the sections */
+static size_t mc_graph_align (size_t size)
+{
+	return (size + 7) & ~(size_t)7;
+}
+
+/* Point the lists of one direction into the mapped offsets, neighbours and multiplicities. The
+ * lists are checked as they are mapped (the view is trusted by the motif routines and edited in
+ * place), returns 1 if they do not cover the entries exactly or hold a neighbour out of range or
+ * order or a multiplicity that is not positive. */
+static int mc_graph_map_lists (mc_list_t **lists, long int nodes, const long long *offsets,
+										 int *neis, int *mult, long long entries)
+{
+	long int v;
+	long long p;
+
+	*lists = (mc_list_t *)calloc(nodes > 0 ? nodes : 1, sizeof(mc_list_t));
+	if (*lists == NULL || offsets[0] != 0 || offsets[nodes] != entries) {
+		return 1;
+	}
+	for (v=0; v<nodes; v++) {
+		if (offsets[v] > offsets[v+1]) {
+			return 1;
+		}
+		for (p=offsets[v]; p<offsets[v+1]; p++) {
+			if (neis[p] < 0 || neis[p] >= nodes || (p > offsets[v] && neis[p] <= neis[p-1]) ||
+				 mult[p] <= 0) {
+				return 1;
+			}
+		}
+		(*lists)[v].neis = neis + offsets[v];
+		(*lists)[v].mult = mult + offsets[v];
+		(*lists)[v].size = (long int)(offsets[v+1] - offsets[v]);
+		(*lists)[v].capacity = 0;
+	}
+	return 0;
+}
+
+/* Write the lists of one direction, returns 1 on failure */
+static int mc_graph_write_lists (FILE *out, const mc_list_t *lists, long int nodes)
+{
+	static const char pad[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	long long offset;
+	long int v, entries;
+
+	offset = 0;
+	for (v=0; v<=nodes; v++) {
+		if (fwrite(&offset, sizeof(long long), 1, out) != 1) return 1;
+		if (v < nodes) offset += lists[v].size;
+	}
+	entries = (long int)offset;
+	for (v=0; v<nodes; v++) {
+		if (fwrite(lists[v].neis, sizeof(int), lists[v].size, out) != (size_t)lists[v].size) return 1;
+	}
+	for (v=0; v<nodes; v++) {
+		if (fwrite(lists[v].mult, sizeof(int), lists[v].size, out) != (size_t)lists[v].size) return 1;
+	}
+	offset = (long long)(mc_graph_align(2*sizeof(int)*entries) - 2*sizeof(int)*entries);
+	if (offset > 0 && fwrite(pad, 1, (size_t)offset, out) != (size_t)offset) return 1;
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Edge list being streamed from a file, with the remapping of its IDs to vertices */
+typedef struct {
+	long int nodes;         /* Number of distinct IDs seen */
+	long int edges;         /* Number of edges read */
+	long int capacity;      /* Space for edges in from and to */
+	int *from, *to;         /* End vertices of the edges */
+	long long *ids;         /* Original ID of each vertex */
+	long int idsCapacity;   /* Space for IDs in ids */
+	int *slots;             /* Hash table of vertices by ID (-1 for empty slots) */
+	long int slotsMask;     /* Number of slots minus one (a power of two) */
+} mc_edges_t;
+
+/* Read buffer size for text edge lists */
+#define MC_EDGES_BUFFER 1048576
+
+static int mc_edges_init (mc_edges_t *el, long int capacity)
+{
+	long int i;
+
+	memset(el, 0, sizeof(mc_edges_t));
+	el->capacity = (capacity > 16) ? capacity : 16;
+	el->idsCapacity = 1024;
+	el->slotsMask = 2047;
+	el->from = (int *)malloc(sizeof(int)*el->capacity);
+	el->to = (int *)malloc(sizeof(int)*el->capacity);
+	el->ids = (long long *)malloc(sizeof(long long)*el->idsCapacity);
+	el->slots = (int *)malloc(sizeof(int)*(el->slotsMask+1));
+	if (el->from == NULL || el->to == NULL || el->ids == NULL || el->slots == NULL) {
+		return 1;
+	}
+	for (i=0; i<=el->slotsMask; i++) {
+		el->slots[i] = -1;
+	}
+	return 0;
+}
+
+static void mc_edges_destroy (mc_edges_t *el)
+{
+	free(el->from);
+	free(el->to);
+	free(el->ids);
+	free(el->slots);
+	memset(el, 0, sizeof(mc_edges_t));
+}
+
+static long int mc_edges_hash (long long id, long int mask)
+{
+	unsigned long long h;
+
+	h = (unsigned long long)id * 0x9E3779B97F4A7C15ULL;
+	return (long int)((h ^ (h >> 29)) & (unsigned long long)mask);
+}
+
+/* Vertex of an ID, a new one is added if the ID has not been seen. Returns -1 on failure. */
+static long int mc_edges_vertex (mc_edges_t *el, long long id)
+{
+	long int i, s, v;
+	int *slots;
+	long long *ids;
+
+	s = mc_edges_hash(id, el->slotsMask);
+	while (el->slots[s] >= 0) {
+		if (el->ids[el->slots[s]] == id) {
+			return el->slots[s];
+		}
+		s = (s + 1) & el->slotsMask;
+	}
+
+	/* Vertex indices are stored as int by the views */
+	if (el->nodes >= 2147483647L) {
+		return -1;
+	}
+	if (el->nodes == el->idsCapacity) {
+		ids = (long long *)realloc(el->ids, sizeof(long long)*2*el->idsCapacity);
+		if (ids == NULL) {
+			return -1;
+		}
+		el->ids = ids;
+		el->idsCapacity *= 2;
+	}
+	v = el->nodes++;
+	el->ids[v] = id;
+	el->slots[s] = (int)v;
+
+	/* Keep the table at most half full */
+	if (2*el->nodes > el->slotsMask) {
+		slots = (int *)malloc(sizeof(int)*2*(el->slotsMask+1));
+		if (slots == NULL) {
+			return -1;
+		}
+		free(el->slots);
+		el->slots = slots;
+		el->slotsMask = 2*el->slotsMask + 1;
+		for (i=0; i<=el->slotsMask; i++) {
+			el->slots[i] = -1;
+		}
+		for (i=0; i<el->nodes; i++) {
+			s = mc_edges_hash(el->ids[i], el->slotsMask);
+			while (el->slots[s] >= 0) {
+				s = (s + 1) & el->slotsMask;
+			}
+			el->slots[s] = (int)i;
+		}
+	}
+	return v;
+}
+
+/* Add an edge between two IDs, returns 1 on failure */
+static int mc_edges_add (mc_edges_t *el, long long source, long long target)
+{
+	long int u, v;
+	int *from, *to;
+
+	u = mc_edges_vertex(el, source);
+	v = (u < 0) ? -1 : mc_edges_vertex(el, target);
+	if (v < 0) {
+		return 1;
+	}
+
+	/* Only grows if the size of the edge list was underestimated */
+	if (el->edges == el->capacity) {
+		from = (int *)realloc(el->from, sizeof(int)*2*el->capacity);
+		if (from != NULL) {
+			el->from = from;
+		}
+		to = (int *)realloc(el->to, sizeof(int)*2*el->capacity);
+		if (to != NULL) {
+			el->to = to;
+		}
+		if (from == NULL || to == NULL) {
+			return 1;
+		}
+		el->capacity *= 2;
+	}
+	el->from[el->edges] = (int)u;
+	el->to[el->edges] = (int)v;
+	el->edges++;
+	return 0;
+}
+
+/* Parse one line of a text edge list (null terminated), returns 1 if it is malformed */
+static int mc_edges_parse_line (mc_edges_t *el, char *line)
+{
+	char *end;
+	long long source, target;
+
+	while (*line == ' ' || *line == '\t') {
+		line++;
+	}
+	if (*line == '\0' || *line == '\r' || *line == '#' || *line == '%') {
+		return 0;
+	}
+	source = strtoll(line, &end, 10);
+	if (end == line) {
+		return 1;
+	}
+	line = end;
+	target = strtoll(line, &end, 10);
+	if (end == line) {
+		return 1;
+	}
+	return mc_edges_add(el, source, target);
+}
+
+/* Stream a text edge list. The edge vectors are sized from the length of the lines at the start
+ * of the file so they rarely need to grow. */
+static int mc_edges_read_text (mc_edges_t *el, FILE *in, long int size)
+{
+	char *buf, *line, *end;
+	size_t have, got;
+	long int lines;
+	int res, eof;
+
+	buf = (char *)malloc(MC_EDGES_BUFFER + 1);
+	if (buf == NULL) {
+		return 1;
+	}
+	have = fread(buf, 1, MC_EDGES_BUFFER, in);
+	eof = (have < MC_EDGES_BUFFER);
+	lines = 1;
+	for (line=buf; line<buf+have; line++) {
+		if (*line == '\n') lines++;
+	}
+	if (mc_edges_init(el, (long int)((double)size * lines / (have + 1) * 1.05) + 16) != 0) {
+		free(buf);
+		return 1;
+	}
+
+	res = 0;
+	while (res == 0 && have > 0) {
+		/* Parse the complete lines in the buffer */
+		line = buf;
+		while (res == 0 && (end = (char *)memchr(line, '\n', have - (line - buf))) != NULL) {
+			*end = '\0';
+			res = mc_edges_parse_line(el, line);
+			line = end + 1;
+		}
+		if (res != 0) {
+			break;
+		}
+
+		/* Move any partial line to the front and refill */
+		have -= (size_t)(line - buf);
+		memmove(buf, line, have);
+		got = eof ? 0 : fread(buf + have, 1, MC_EDGES_BUFFER - have, in);
+		eof = eof || (got < MC_EDGES_BUFFER - have);
+		if (got == 0) {
+			/* Last line without a newline, or one too long for the buffer */
+			if (have > 0) {
+				buf[have] = '\0';
+				res = (have == MC_EDGES_BUFFER) ? 1 : mc_edges_parse_line(el, buf);
+			}
+			break;
+		}
+		have += got;
+	}
+
+	free(buf);
+	return res;
+}
+
+/* Stream a binary edge list, its size gives the number of edges exactly */
+static int mc_edges_read_binary (mc_edges_t *el, FILE *in, long int size)
+{
+	long long pairs[2*4096];
+	size_t got, i;
+	int res;
+
+	if (size % (2*sizeof(long long)) != 0 || mc_edges_init(el, size / (2*sizeof(long long))) != 0) {
+		return 1;
+	}
+	res = 0;
+	while (res == 0 && (got = fread(pairs, 2*sizeof(long long), 4096, in)) > 0) {
+		for (i=0; res==0 && i<got; i++) {
+			res = mc_edges_add(el, pairs[2*i], pairs[2*i+1]);
+		}
+	}
+	return res;
+}
+
+/* Read a text or binary edge list */
+static int mc_edges_read (mc_edges_t *el, const char *filename, int format)
+{
+	FILE *in;
+	struct stat st;
+	int res;
+
+	memset(el, 0, sizeof(mc_edges_t));
+	in = fopen(filename, "rb");
+	if (in == NULL) {
+		return 1;
+	}
+	if (fstat(fileno(in), &st) != 0) {
+		fclose(in);
+		return 1;
+	}
+	if (format == MC_FORMAT_EDGES_BINARY) {
+		res = mc_edges_read_binary(el, in, (long int)st.st_size);
+	}
+	else {
+		res = mc_edges_read_text(el, in, (long int)st.st_size);
+	}
+	fclose(in);
+	if (res != 0) {
+		mc_edges_destroy(el);
+	}
+	return res;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_graph_file_format (const char *filename)
+{
+	FILE *in;
+	char head[4096];
+	size_t got, i;
+
+	in = fopen(filename, "rb");
+	if (in == NULL) {
+		return MC_FORMAT_GML;
+	}
+	got = fread(head, 1, sizeof(head), in);
+	fclose(in);
+
+	if (got >= 8 && memcmp(head, MC_GRAPH_MAGIC, 8) == 0) {
+		return MC_FORMAT_BINARY;
+	}
+	if (got >= 2*sizeof(long long) && memchr(head, '\0', 2*sizeof(long long)) != NULL) {
+		return MC_FORMAT_EDGES_BINARY;
+	}
+
+	/* Skip blank and comment lines to the first line with content */
+	i = 0;
+	while (i < got) {
+		if (head[i] == '#' || head[i] == '%') {
+			while (i < got && head[i] != '\n') i++;
+		}
+		else if (head[i] == ' ' || head[i] == '\t' || head[i] == '\r' || head[i] == '\n') {
+			i++;
+		}
+		else {
+			break;
+		}
+	}
+	if (i < got && ((head[i] >= '0' && head[i] <= '9') || head[i] == '-')) {
+		return MC_FORMAT_EDGES;
+	}
+	return MC_FORMAT_GML;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_graph_file_open (mc_graph_file_t *gf, const char *filename, igraph_bool_t directed)
+{
+	const mc_graph_header_t *h;
+	igraph_attribute_table_t *table;
+	struct stat st;
+	igraph_t graph;
+	long long *ids;
+	mc_edges_t el;
+	FILE *in;
+	char *p;
+	long int nodes, v;
+	size_t need;
+	int fd, res, format;
+
+	memset(gf, 0, sizeof(mc_graph_file_t));
+	format = mc_graph_file_format(filename);
+
+	/* Edge lists are built straight into the view, which keeps their IDs */
+	if (format == MC_FORMAT_EDGES || format == MC_FORMAT_EDGES_BINARY) {
+		if (mc_edges_read(&el, filename, format) != 0) {
+			return 1;
+		}
+		gf->edges = el.edges;
+		res = mc_graph_build(&gf->view, el.nodes, directed, el.from, el.to, el.edges);
+		gf->ids = el.ids;
+		el.ids = NULL;
+		mc_edges_destroy(&el);
+		return res;
+	}
+
+	/* GML files are read and converted, keeping the id attribute of their nodes (the attribute
+	   handler is only installed while the graph exists) */
+	if (format == MC_FORMAT_GML) {
+		in = fopen(filename, "r");
+		if (in == NULL) {
+			return 1;
+		}
+		table = igraph_i_set_attribute_table(&igraph_cattribute_table);
+		res = igraph_read_graph_gml(&graph, in);
+		fclose(in);
+		if (res != 0) {
+			igraph_i_set_attribute_table(table);
+			return 1;
+		}
+		gf->edges = (long int)igraph_ecount(&graph);
+		res = mc_graph_init(&gf->view, &graph);
+		if (res == 0 && igraph_cattribute_has_attr(&graph, IGRAPH_ATTRIBUTE_VERTEX, "id")) {
+			ids = (long long *)malloc(sizeof(long long)*(gf->view.nodes + 1));
+			if (ids == NULL) {
+				res = 1;
+			}
+			else {
+				for (v=0; v<gf->view.nodes; v++) {
+					ids[v] = (long long)VAN(&graph, "id", v);
+				}
+			}
+			gf->ids = ids;
+		}
+		igraph_destroy(&graph);
+		igraph_i_set_attribute_table(table);
+		if (res != 0) {
+			mc_graph_file_close(gf);
+		}
+		return res;
+	}
+
+	/* Binary files are mapped privately so that the (copy-on-write) lists can still be edited */
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return 1;
+	}
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(mc_graph_header_t)) {
+		close(fd);
+		return 1;
+	}
+	gf->size = (size_t)st.st_size;
+	gf->data = mmap(NULL, gf->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (gf->data == MAP_FAILED) {
+		gf->data = NULL;
+		return 1;
+	}
+
+	/* Sizes are checked against the file before they are used to find the sections */
+	h = (const mc_graph_header_t *)gf->data;
+	if (h->version != 1 || h->nodes < 0 || h->nodes >= 2147483647LL || h->outEntries < 0 ||
+		 h->inEntries < 0 || h->outEntries > (long long)gf->size || 
+		 h->inEntries > (long long)gf->size) {
+		mc_graph_file_close(gf);
+		return 1;
+	}
+	nodes = (long int)h->nodes;
+	need = sizeof(mc_graph_header_t) + sizeof(long long)*(nodes+1) +
+		mc_graph_align(2*sizeof(int)*h->outEntries) + mc_graph_align(sizeof(int)*nodes);
+	if ((h->flags & MC_GRAPH_DIRECTED) != 0) {
+		need += sizeof(long long)*(nodes+1) + mc_graph_align(2*sizeof(int)*h->inEntries);
+	}
+	if ((h->flags & MC_GRAPH_IDS) != 0) {
+		need += sizeof(long long)*nodes;
+	}
+	if (need > gf->size) {
+		mc_graph_file_close(gf);
+		return 1;
+	}
+
+	gf->view.nodes = nodes;
+	gf->view.directed = ((h->flags & MC_GRAPH_DIRECTED) != 0);
+	gf->edges = (long int)h->edges;
+
+	p = (char *)gf->data + sizeof(mc_graph_header_t);
+	res = mc_graph_map_lists(&gf->view.out, nodes, (const long long *)p,
+									 (int *)(p + sizeof(long long)*(nodes+1)),
+									 (int *)(p + sizeof(long long)*(nodes+1)) + h->outEntries, h->outEntries);
+	p += sizeof(long long)*(nodes+1) + mc_graph_align(2*sizeof(int)*h->outEntries);
+	if (gf->view.directed != 0) {
+		if (res == 0) {
+			res = mc_graph_map_lists(&gf->view.in, nodes, (const long long *)p,
+											 (int *)(p + sizeof(long long)*(nodes+1)),
+											 (int *)(p + sizeof(long long)*(nodes+1)) + h->inEntries,
+											 h->inEntries);
+		}
+		p += sizeof(long long)*(nodes+1) + mc_graph_align(2*sizeof(int)*h->inEntries);
+	}
+	else {
+		gf->view.in = gf->view.out;
+	}
+
+	/* Loop counts are edited in place by the view so they get their own copy */
+	gf->view.loops = (int *)malloc(sizeof(int)*(nodes > 0 ? nodes : 1));
+	if (res != 0 || gf->view.loops == NULL) {
+		mc_graph_file_close(gf);
+		return 1;
+	}
+	for (v=0; v<nodes; v++) {
+		gf->view.loops[v] = ((const int *)p)[v];
+		if (gf->view.loops[v] < 0) {
+			mc_graph_file_close(gf);
+			return 1;
+		}
+	}
+	p += mc_graph_align(sizeof(int)*nodes);
+
+	if ((h->flags & MC_GRAPH_IDS) != 0) {
+		gf->ids = (const long long *)p;
+	}
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void mc_graph_file_close (mc_graph_file_t *gf)
+{
+	mc_graph_destroy(&gf->view);
+	if (gf->data != NULL) {
+		munmap(gf->data, gf->size);
+	}
+	else {
+		free((long long *)gf->ids);
+	}
+	gf->data = NULL;
+	gf->ids = NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_graph_file_write (const char *filename, const mc_graph_t *g, long int edges,
+								 const long long *ids)
+{
+	static const char pad[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	mc_graph_header_t h;
+	FILE *out;
+	long int v;
+	size_t extra;
+	int res;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, MC_GRAPH_MAGIC, sizeof(h.magic));
+	h.version = 1;
+	h.flags = ((g->directed != 0) ? MC_GRAPH_DIRECTED : 0) | ((ids != NULL) ? MC_GRAPH_IDS : 0);
+	h.nodes = g->nodes;
+	h.edges = edges;
+	for (v=0; v<g->nodes; v++) {
+		h.outEntries += g->out[v].size;
+		if (g->directed != 0) {
+			h.inEntries += g->in[v].size;
+		}
+	}
+
+	out = fopen(filename, "wb");
+	if (out == NULL) {
+		return 1;
+	}
+	res = (fwrite(&h, sizeof(h), 1, out) != 1);
+	if (res == 0) {
+		res = mc_graph_write_lists(out, g->out, g->nodes);
+	}
+	if (res == 0 && g->directed != 0) {
+		res = mc_graph_write_lists(out, g->in, g->nodes);
+	}
+	if (res == 0) {
+		res = (fwrite(g->loops, sizeof(int), g->nodes, out) != (size_t)g->nodes);
+		extra = mc_graph_align(sizeof(int)*g->nodes) - sizeof(int)*g->nodes;
+		if (res == 0 && extra > 0) {
+			res = (fwrite(pad, 1, extra, out) != extra);
+		}
+	}
+	if (res == 0 && ids != NULL) {
+		res = (fwrite(ids, sizeof(long long), g->nodes, out) != (size_t)g->nodes);
+	}
+	if (fclose(out) != 0) {
+		res = 1;
+	}
+
+	return res;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_graph_read (igraph_t *graph, const char *filename, igraph_bool_t directed)
+{
+	mc_graph_file_t gf;
+	mc_edges_t el;
+	igraph_vector_t edges;
+	FILE *in;
+	long int v, p, k, e;
+	int u, res, format;
+
+	format = mc_graph_file_format(filename);
+
+	if (format == MC_FORMAT_GML) {
+		in = fopen(filename, "r");
+		if (in == NULL) {
+			return 1;
+		}
+		res = igraph_read_graph_gml(graph, in);
+		fclose(in);
+		return (res != 0);
+	}
+
+	/* Edge lists are streamed into an edge vector of the final size */
+	if (format == MC_FORMAT_EDGES || format == MC_FORMAT_EDGES_BINARY) {
+		if (mc_edges_read(&el, filename, format) != 0) {
+			return 1;
+		}
+		igraph_vector_init(&edges, 2*el.edges);
+		for (e=0; e<el.edges; e++) {
+			VECTOR(edges)[2*e] = (igraph_real_t)el.from[e];
+			VECTOR(edges)[2*e+1] = (igraph_real_t)el.to[e];
+		}
+		res = igraph_create(graph, &edges, (igraph_integer_t)el.nodes, directed);
+		igraph_vector_destroy(&edges);
+		mc_edges_destroy(&el);
+		return (res != 0);
+	}
+
+	if (mc_graph_file_open(&gf, filename, directed) != 0) {
+		return 1;
+	}
+	/* Undirected edges are only taken from the lists of their smaller end */
+	igraph_vector_init(&edges, 2*gf.edges);
+	e = 0;
+	for (v=0; v<gf.view.nodes; v++) {
+		for (p=0; p<gf.view.out[v].size; p++) {
+			u = gf.view.out[v].neis[p];
+			if (gf.view.directed == 0 && u < v) {
+				continue;
+			}
+			for (k=0; k<gf.view.out[v].mult[p] && e < gf.edges; k++) {
+				VECTOR(edges)[2*e] = (igraph_real_t)v;
+				VECTOR(edges)[2*e+1] = (igraph_real_t)u;
+				e++;
+			}
+		}
+		for (k=0; k<gf.view.loops[v] && e < gf.edges; k++) {
+			VECTOR(edges)[2*e] = (igraph_real_t)v;
+			VECTOR(edges)[2*e+1] = (igraph_real_t)v;
+			e++;
+		}
+	}
+	igraph_vector_resize(&edges, 2*e);
+	res = igraph_create(graph, &edges, (igraph_integer_t)gf.view.nodes, gf.view.directed);
+
+	igraph_vector_destroy(&edges);
+	mc_graph_file_close(&gf);
+	return (res != 0);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
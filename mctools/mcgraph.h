@@ -0,0 +1,113 @@
+/*===============================================================================================
+ *  mcgraph.h
+ *
+ *  Graph input shared by the mctools command line applications. Besides GML, graphs can be held
+ *  in a compact binary format (written by mcconvert) that is memory mapped when loaded, so the
+ *  adjacency used by the motif routines points straight into the file. Large graphs can also be
+ *  streamed from edge lists, either text (one "source target" pair of integer IDs per line,
+ *  separated by tabs or spaces, lines starting with # or % are comments) or binary (native 64-bit
+ *  integer source,target pairs with no header). The IDs of an edge list are remapped densely to
+ *  vertices 0..n-1 in the order they are first seen and kept so outputs can report them, as are
+ *  the id attributes of the nodes of GML files. The format of a file is detected from its
+ *  contents. Compile mcgraph.c and mcmotif.c alongside the application, e.g.
+ *
+ *     gcc -I INC_DIR -L LIB_DIR -O3 mcc.c mcmotif.c mcgraph.c -ligraph -lstdc++ -o mcc -Wall
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Binary format (native byte order, every section starts on an 8 byte boundary):
+ *
+ *     header     : mc_graph_header_t (magic "MCGRAPH1")
+ *     out lists  : nodes+1 offsets (int64), neighbours (int32), multiplicities (int32)
+ *     in lists   : as the out lists, directed graphs only
+ *     loops      : number of self-loops on each vertex (int32)
+ *     ids        : original ID of each vertex (int64), only if MC_GRAPH_IDS is set
+ *
+ *  The lists are those of mc_graph_t: each vertex's neighbours in ascending order with the number
+ *  of edges to each one, self-loops excluded. Undirected edges appear in both end's lists. Files
+ *  whose lists break this (or do not fit the file) are rejected when they are opened.
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#ifndef MCGRAPH_H
+#define MCGRAPH_H
+
+#include <stddef.h>
+#include <igraph.h>
+#include "mcmotif.h"
+
+/* Identifies binary graph files */
+#define MC_GRAPH_MAGIC "MCGRAPH1"
+
+/* Header flags */
+#define MC_GRAPH_DIRECTED 1
+#define MC_GRAPH_IDS      2
+
+/* Input file formats */
+#define MC_FORMAT_GML          0
+#define MC_FORMAT_BINARY       1
+#define MC_FORMAT_EDGES        2
+#define MC_FORMAT_EDGES_BINARY 3
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Header of a binary graph file (64 bytes). */
+typedef struct {
+	char magic[8];         /* MC_GRAPH_MAGIC */
+	int version;           /* Format version (1) */
+	int flags;             /* MC_GRAPH_DIRECTED and MC_GRAPH_IDS */
+	long long nodes;       /* Number of vertices */
+	long long edges;       /* Number of edges, counting multiple edges and self-loops */
+	long long outEntries;  /* Total length of the out lists */
+	long long inEntries;   /* Total length of the in lists (0 for undirected graphs) */
+	long long reserved[2]; /* Unused, zero */
+} mc_graph_header_t;
+
+/* Graph loaded from a file. The adjacency view of a binary file points into the mapping and must
+ * not outlive it. */
+typedef struct {
+	mc_graph_t view;        /* Adjacency view of the graph */
+	long int edges;         /* Number of edges, counting multiple edges and self-loops */
+	const long long *ids;   /* Original ID of each vertex, NULL if not known */
+	void *data;             /* Mapping of a binary file, NULL for other formats */
+	size_t size;            /* Length of the mapping */
+} mc_graph_file_t;
+
+/* Detect the format of a graph file (MC_FORMAT_*). Binary files are recognised by their magic,
+ * binary edge lists by the zero bytes in their first IDs (so IDs must be below 2^56) and text
+ * edge lists by a number at the start of their first line that is not a comment. Any other file
+ * is taken to be GML. */
+int mc_graph_file_format (const char *filename);
+
+/* Load the view of a graph from a file in any of the formats. Binary files are memory mapped, GML
+ * files are read with igraph and converted and edge lists are streamed in a single pass. Edge
+ * lists are read as directed or undirected graphs as given, the other formats record this
+ * themselves. The original IDs are those of the edge list, the id attributes of GML nodes or
+ * those stored in a binary file. Returns 1 on failure. */
+int mc_graph_file_open (mc_graph_file_t *gf, const char *filename, igraph_bool_t directed);
+
+/* Free the view of a graph and unmap its file. */
+void mc_graph_file_close (mc_graph_file_t *gf);
+
+/* Write the view of a graph to a binary file, with the original vertex IDs if ids is not NULL.
+ * Returns 1 on failure. */
+int mc_graph_file_write (const char *filename, const mc_graph_t *g, long int edges,
+								 const long long *ids);
+
+/* Read a graph from a file in any of the formats into igraph form (see mc_graph_file_open), for
+ * the few uses that need igraph (e.g. motif files). For binary files the edges are listed by
+ * source vertex rather than in the order of the original graph. Large graphs should be opened
+ * with mc_graph_file_open instead, which avoids the copies. Returns 1 on failure. */
+int mc_graph_read (igraph_t *graph, const char *filename, igraph_bool_t directed);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,178 @@
+/*===============================================================================================
+ *  mcmetrics.c
+ *
+ *  Run time metrics shared by the mctools command line applications. See mcmetrics.h for
+ *  details.
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "mcmetrics.h"
+
+/* Names of the phases and counters in the report */
+static const char *mc_metrics_phase_names[MC_PHASES] = {"load", "types", "motifs", "pairs",
+																		  "samples", "output"};
+static const char *mc_metrics_counter_names[MC_COUNTERS] = {"raw_mappings", "rejected_mappings",
+	"unique_instances", "overlapping_pairs", "placement_trials", "placement_accepts",
+	"placement_rejects", "samples", "failed_samples"};
+
+/* State of the metrics */
+static int mc_metrics_on = 0;
+static double mc_metrics_start[2];
+static double mc_metrics_phase_start[MC_PHASES][2];
+static double mc_metrics_phase_total[MC_PHASES][2];
+static long int mc_metrics_phase_calls[MC_PHASES];
+static long long mc_metrics_counters[MC_COUNTERS];
+static int mc_metrics_counter_used[MC_COUNTERS];
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Wall (monotonic) and process CPU time in seconds */
+static void mc_metrics_now (double *now)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now[0] = (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	now[1] = (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
+
+/* Write a string as a JSON string */
+static void mc_metrics_string (FILE *out, const char *s)
+{
+	fputc('"', out);
+	for (; *s != '\0'; s++) {
+		if (*s == '"' || *s == '\\') {
+			fprintf(out, "\\%c", *s);
+		}
+		else if ((unsigned char)*s < 0x20) {
+			fprintf(out, "\\u%04x", (unsigned int)(unsigned char)*s);
+		}
+		else {
+			fputc(*s, out);
+		}
+	}
+	fputc('"', out);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void mc_metrics_enable (void)
+{
+	memset(mc_metrics_phase_total, 0, sizeof(mc_metrics_phase_total));
+	memset(mc_metrics_phase_calls, 0, sizeof(mc_metrics_phase_calls));
+	memset(mc_metrics_counters, 0, sizeof(mc_metrics_counters));
+	memset(mc_metrics_counter_used, 0, sizeof(mc_metrics_counter_used));
+	mc_metrics_now(mc_metrics_start);
+	mc_metrics_on = 1;
+}
+
+int mc_metrics_enabled (void)
+{
+	return mc_metrics_on;
+}
+
+void mc_metrics_begin (int phase)
+{
+	if (mc_metrics_on == 0) {
+		return;
+	}
+	mc_metrics_now(mc_metrics_phase_start[phase]);
+}
+
+void mc_metrics_end (int phase)
+{
+	double now[2];
+
+	if (mc_metrics_on == 0) {
+		return;
+	}
+	mc_metrics_now(now);
+	mc_metrics_phase_total[phase][0] += now[0] - mc_metrics_phase_start[phase][0];
+	mc_metrics_phase_total[phase][1] += now[1] - mc_metrics_phase_start[phase][1];
+	mc_metrics_phase_calls[phase]++;
+}
+
+void mc_metrics_add (int counter, long long n)
+{
+	if (mc_metrics_on == 0) {
+		return;
+	}
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+	mc_metrics_counters[counter] += n;
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+	mc_metrics_counter_used[counter] = 1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_metrics_write (const char *filename, const char *tool, int argc, const char **argv)
+{
+	struct rusage usage;
+	double now[2];
+	FILE *out;
+	int i, first;
+
+	if (mc_metrics_on == 0) {
+		return 1;
+	}
+	mc_metrics_now(now);
+	memset(&usage, 0, sizeof(usage));
+	getrusage(RUSAGE_SELF, &usage);
+
+	out = fopen(filename, "w");
+	if (out == NULL) {
+		return 1;
+	}
+	fprintf(out, "{\"tool\": ");
+	mc_metrics_string(out, tool);
+	fprintf(out, ", \"args\": [");
+	for (i=1; i<argc; i++) {
+		if (i > 1) fprintf(out, ", ");
+		mc_metrics_string(out, argv[i]);
+	}
+	fprintf(out, "], \"wall_seconds\": %.6f, \"cpu_seconds\": %.6f, \"peak_rss_kb\": %li,\n",
+			  now[0] - mc_metrics_start[0], now[1] - mc_metrics_start[1], (long int)usage.ru_maxrss);
+
+	/* Phases and counters that were used */
+	fprintf(out, " \"phases\": {");
+	first = 1;
+	for (i=0; i<MC_PHASES; i++) {
+		if (mc_metrics_phase_calls[i] > 0) {
+			fprintf(out, "%s\n  \"%s\": {\"wall_seconds\": %.6f, \"cpu_seconds\": %.6f, \"calls\": %li}",
+					  (first != 0) ? "" : ",", mc_metrics_phase_names[i], mc_metrics_phase_total[i][0],
+					  mc_metrics_phase_total[i][1], mc_metrics_phase_calls[i]);
+			first = 0;
+		}
+	}
+	fprintf(out, "},\n \"counters\": {");
+	first = 1;
+	for (i=0; i<MC_COUNTERS; i++) {
+		if (mc_metrics_counter_used[i] != 0) {
+			fprintf(out, "%s\n  \"%s\": %lli", (first != 0) ? "" : ",", mc_metrics_counter_names[i],
+					  mc_metrics_counters[i]);
+			first = 0;
+		}
+	}
+	fprintf(out, "}}\n");
+
+	return (fclose(out) != 0) ? 1 : 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
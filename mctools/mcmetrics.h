@@ -0,0 +1,79 @@
+/*===============================================================================================
+ *  mcmetrics.h
+ *
+ *  Run time metrics shared by the mctools command line applications. When enabled (by the
+ *  --metrics FILE option of each tool) the wall and CPU time of the main phases of a run are
+ *  measured with monotonic clocks, counters of the work done are kept and a single JSON report
+ *  of them, with the peak resident memory of the process, is written at the end:
+ *
+ *     {"tool": "mcc", "args": [...], "wall_seconds": 1.2, "cpu_seconds": 4.1,
+ *      "peak_rss_kb": 20480, "phases": {"load": {"wall_seconds": 0.1, "cpu_seconds": 0.1,
+ *      "calls": 1}, ...}, "counters": {"raw_mappings": 1200, ...}}
+ *
+ *  Only the phases and counters a run used are reported. The CPU time is that of the whole
+ *  process, so it exceeds the wall time of phases run on several threads. Phases are timed from
+ *  serial code only, counters can be added to from any thread. When disabled every call returns
+ *  at once. Compile mcmetrics.c alongside the application, e.g.
+ *
+ *     gcc -I INC_DIR -L LIB_DIR -O3 mcstats.c mcmotif.c mcgraph.c mccluster.c mcregistry.c
+ *         mcmetrics.c -ligraph -lstdc++ -o mcstats
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#ifndef MCMETRICS_H
+#define MCMETRICS_H
+
+/* Phases of a run (reported as "load", "types", "motifs", "pairs", "samples" and "output") */
+#define MC_PHASE_LOAD 0     /* Reading the graph and motif */
+#define MC_PHASE_TYPES 1    /* Finding the clustering types of the motif */
+#define MC_PHASE_MOTIFS 2   /* Finding the motif instances of the graph */
+#define MC_PHASE_PAIRS 3    /* Classifying the pairs of motif instances */
+#define MC_PHASE_SAMPLES 4  /* Generating and measuring the random samples */
+#define MC_PHASE_OUTPUT 5   /* Writing the results */
+#define MC_PHASES 6
+
+/* Counters of a run (reported under the names given). The first four describe the graph being
+   studied in every tool (summed over the graphs of a batch), never the random samples of mcc */
+#define MC_COUNT_MAPPINGS 0     /* "raw_mappings": motif mappings found by the enumeration */
+#define MC_COUNT_REJECTED 1     /* "rejected_mappings": mappings that were not proper motifs */
+#define MC_COUNT_INSTANCES 2    /* "unique_instances": motif instances of the graph */
+#define MC_COUNT_OVERLAPPING 3  /* "overlapping_pairs": pairs of instances sharing a vertex */
+#define MC_COUNT_TRIALS 4       /* "placement_trials": motif placements tried in the samples */
+#define MC_COUNT_ACCEPTS 5      /* "placement_accepts": placements kept */
+#define MC_COUNT_REJECTS 6      /* "placement_rejects": placements undone */
+#define MC_COUNT_SAMPLES 7      /* "samples": random samples completed */
+#define MC_COUNT_FAILED 8       /* "failed_samples": random samples that could not be generated */
+#define MC_COUNTERS 9
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Enable the metrics, the run time is measured from this call. */
+void mc_metrics_enable (void);
+
+/* Whether the metrics are enabled. */
+int mc_metrics_enabled (void);
+
+/* Start timing a phase (from serial code). A phase can be timed several times, its times add up. */
+void mc_metrics_begin (int phase);
+
+/* Stop timing a phase. */
+void mc_metrics_end (int phase);
+
+/* Add to a counter (from any thread). */
+void mc_metrics_add (int counter, long long n);
+
+/* Write the JSON report of the run of a tool with its arguments to a file. Returns 1 on failure
+ * (or if the metrics are not enabled). */
+int mc_metrics_write (const char *filename, const char *tool, int argc, const char **argv);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,1643 @@
+/*===============================================================================================
+ *  mcmotif.c
+ *
+ *  Motif routines shared by the mctools command line applications. See mcmotif.h for details.
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "mcmotif.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Compare two vertex IDs (for qsort) */
+static int mc_compare_int (const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+	return (x > y) - (x < y);
+}
+
+/* Fill one direction of the graph from an edge list, sorting each neighbour list and merging
+ * duplicate edges into a multiplicity. All lists share one block of storage */
+static int mc_graph_fill (long int nodes, long int edges, const int *src, const int *dst,
+								  mc_list_t **lists, int **block)
+{
+	long int e, v, p, start, end, next, *offsets;
+	int *neis, *mult;
+
+	*lists = (mc_list_t *)calloc(nodes > 0 ? nodes : 1, sizeof(mc_list_t));
+	*block = (int *)malloc(sizeof(int)*2*(edges > 0 ? edges : 1));
+	offsets = (long int *)calloc(nodes+1, sizeof(long int));
+	if (*lists == NULL || *block == NULL || offsets == NULL) {
+		free(offsets);
+		return 1;
+	}
+	neis = *block;
+	mult = *block + edges;
+
+	for (e=0; e<edges; e++) {
+		offsets[src[e]+1]++;
+	}
+	for (v=0; v<nodes; v++) {
+		offsets[v+1] += offsets[v];
+	}
+	for (e=0; e<edges; e++) {
+		neis[offsets[src[e]]] = dst[e];
+		offsets[src[e]]++;
+	}
+
+	/* Sort each list and compact duplicate edges into their multiplicity */
+	start = 0;
+	for (v=0; v<nodes; v++) {
+		end = offsets[v];
+		qsort(neis + start, end - start, sizeof(int), mc_compare_int);
+		next = start;
+		for (p=start; p<end; p++) {
+			if (p == start || neis[p] != neis[p-1]) {
+				neis[next] = neis[p];
+				mult[next] = 1;
+				next++;
+			}
+			else {
+				mult[next-1]++;
+			}
+		}
+		(*lists)[v].neis = neis + start;
+		(*lists)[v].mult = mult + start;
+		(*lists)[v].size = next - start;
+		(*lists)[v].capacity = 0;
+		start = end;
+	}
+
+	free(offsets);
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_graph_init (mc_graph_t *g, const igraph_t *graph)
+{
+	long int e, edges;
+	int *from, *to;
+	int res;
+
+	edges = (long int)igraph_ecount(graph);
+	from = (int *)malloc(sizeof(int)*(edges+1));
+	to = (int *)malloc(sizeof(int)*(edges+1));
+	if (from == NULL || to == NULL) {
+		free(from);
+		free(to);
+		return 1;
+	}
+	for (e=0; e<edges; e++) {
+		from[e] = (int)IGRAPH_FROM(graph, e);
+		to[e] = (int)IGRAPH_TO(graph, e);
+	}
+
+	res = mc_graph_build(g, (long int)igraph_vcount(graph), igraph_is_directed(graph), from, to,
+								edges);
+
+	free(from);
+	free(to);
+	return res;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_graph_build (mc_graph_t *g, long int nodes, igraph_bool_t directed, const int *from,
+						  const int *to, long int edges)
+{
+	long int e, count;
+	int *src, *dst;
+	int res;
+
+	g->nodes = nodes;
+	g->directed = directed;
+	g->out = NULL;
+	g->in = NULL;
+	g->outBlock = NULL;
+	g->inBlock = NULL;
+	g->loops = (int *)calloc(g->nodes > 0 ? g->nodes : 1, sizeof(int));
+
+	/* Undirected edges are stored in both directions */
+	src = (int *)malloc(sizeof(int)*(2*edges+1));
+	dst = (int *)malloc(sizeof(int)*(2*edges+1));
+	if (src == NULL || dst == NULL || g->loops == NULL) {
+		free(src);
+		free(dst);
+		return 1;
+	}
+	count = 0;
+	for (e=0; e<edges; e++) {
+		if (from[e] == to[e]) {
+			/* Self-loops can never be part of a motif mapping, only count them */
+			g->loops[from[e]]++;
+			continue;
+		}
+		src[count] = from[e];
+		dst[count] = to[e];
+		count++;
+		if (g->directed == 0) {
+			src[count] = to[e];
+			dst[count] = from[e];
+			count++;
+		}
+	}
+
+	res = mc_graph_fill(g->nodes, count, src, dst, &g->out, &g->outBlock);
+	if (res == 0) {
+		if (g->directed != 0) {
+			res = mc_graph_fill(g->nodes, count, dst, src, &g->in, &g->inBlock);
+		}
+		else {
+			g->in = g->out;
+		}
+	}
+
+	free(src);
+	free(dst);
+	return res;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Binary search for a vertex in a sorted neighbour list, returns its position or where it would
+   be inserted as -(position+1) */
+static long int mc_list_find (const mc_list_t *list, int v)
+{
+	long int lo = 0, hi = list->size - 1, mid;
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (list->neis[mid] == v) return mid;
+		if (list->neis[mid] < v) lo = mid + 1;
+		else hi = mid - 1;
+	}
+	return -(lo + 1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Add (delta = 1) or remove (delta = -1) one edge to v in a neighbour list */
+static int mc_list_update (mc_list_t *list, int v, int delta)
+{
+	long int pos, capacity;
+	int *neis;
+
+	pos = mc_list_find(list, v);
+	if (pos >= 0) {
+		list->mult[pos] += delta;
+		if (list->mult[pos] == 0) {
+			memmove(list->neis + pos, list->neis + pos + 1, sizeof(int)*(list->size - pos - 1));
+			memmove(list->mult + pos, list->mult + pos + 1, sizeof(int)*(list->size - pos - 1));
+			list->size--;
+		}
+		return 0;
+	}
+	if (delta < 0) {
+		return 1;
+	}
+
+	/* New neighbour, lists in the shared block move to their own storage when they grow */
+	pos = -pos - 1;
+	if (list->size == list->capacity || list->capacity == 0) {
+		capacity = 2*list->size + 4;
+		neis = (int *)malloc(sizeof(int)*2*capacity);
+		if (neis == NULL) {
+			return 1;
+		}
+		memcpy(neis, list->neis, sizeof(int)*list->size);
+		memcpy(neis + capacity, list->mult, sizeof(int)*list->size);
+		if (list->capacity != 0) {
+			free(list->neis);
+		}
+		list->neis = neis;
+		list->mult = neis + capacity;
+		list->capacity = capacity;
+	}
+	memmove(list->neis + pos + 1, list->neis + pos, sizeof(int)*(list->size - pos));
+	memmove(list->mult + pos + 1, list->mult + pos, sizeof(int)*(list->size - pos));
+	list->neis[pos] = v;
+	list->mult[pos] = 1;
+	list->size++;
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_graph_add_edge (mc_graph_t *g, int from, int to)
+{
+	if (from == to) {
+		g->loops[from]++;
+		return 0;
+	}
+	if (mc_list_update(&g->out[from], to, 1) != 0) {
+		return 1;
+	}
+	return mc_list_update(&g->in[to], from, 1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_graph_remove_edge (mc_graph_t *g, int from, int to)
+{
+	if (from == to) {
+		if (g->loops[from] == 0) {
+			return 1;
+		}
+		g->loops[from]--;
+		return 0;
+	}
+	if (mc_list_update(&g->out[from], to, -1) != 0) {
+		return 1;
+	}
+	return mc_list_update(&g->in[to], from, -1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_graph_multiplicity (const mc_graph_t *g, int from, int to)
+{
+	const mc_list_t *list;
+	long int pos;
+	int v;
+
+	/* Search the shorter of the two lists */
+	if (g->out[from].size <= g->in[to].size) {
+		list = &g->out[from];
+		v = to;
+	}
+	else {
+		list = &g->in[to];
+		v = from;
+	}
+	pos = mc_list_find(list, v);
+	return (pos < 0) ? 0 : list->mult[pos];
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+igraph_bool_t mc_graph_has_edge (const mc_graph_t *g, int from, int to)
+{
+	return (mc_graph_multiplicity(g, from, to) > 0);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Free the neighbour lists that have moved out of the shared block */
+static void mc_graph_free_lists (mc_list_t *lists, long int nodes)
+{
+	long int v;
+	for (v=0; v<nodes; v++) {
+		if (lists[v].capacity != 0) {
+			free(lists[v].neis);
+		}
+	}
+	free(lists);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void mc_graph_destroy (mc_graph_t *g)
+{
+	if (g->out != NULL) {
+		mc_graph_free_lists(g->out, g->nodes);
+	}
+	if (g->in != NULL && g->in != g->out) {
+		mc_graph_free_lists(g->in, g->nodes);
+	}
+	free(g->outBlock);
+	free(g->inBlock);
+	free(g->loops);
+	g->out = NULL;
+	g->in = NULL;
+	g->outBlock = NULL;
+	g->inBlock = NULL;
+	g->loops = NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Collect all automorphisms of the motif by trying every permutation (motifs are tiny) */
+static int mc_motif_automorphisms (mc_motif_t *m)
+{
+	int perm[MC_MAX_MOTIF], used[MC_MAX_MOTIF], depth, v, i, ok;
+	long int capacity;
+	int *newAutos;
+
+	capacity = 16;
+	m->autos = (int *)malloc(sizeof(int)*capacity*m->size);
+	if (m->autos == NULL) {
+		return 1;
+	}
+	m->automorphisms = 0;
+
+	memset(used, 0, sizeof(used));
+	depth = 0;
+	perm[0] = -1;
+	while (depth >= 0) {
+		/* Move to the next unused vertex at this depth */
+		if (perm[depth] >= 0) {
+			used[perm[depth]] = 0;
+		}
+		v = perm[depth] + 1;
+		while (v < m->size && used[v] != 0) v++;
+		if (v >= m->size) {
+			depth--;
+			continue;
+		}
+		perm[depth] = v;
+
+		/* Adjacency to all earlier vertices must be preserved */
+		ok = 1;
+		for (i=0; i<=depth && ok; i++) {
+			if (m->adj[i][depth] != m->adj[perm[i]][v] || m->adj[depth][i] != m->adj[v][perm[i]]) {
+				ok = 0;
+			}
+		}
+		if (ok == 0) {
+			continue;
+		}
+		used[v] = 1;
+
+		if (depth == m->size-1) {
+			if (m->automorphisms == capacity) {
+				capacity *= 2;
+				newAutos = (int *)realloc(m->autos, sizeof(int)*capacity*m->size);
+				if (newAutos == NULL) {
+					return 1;
+				}
+				m->autos = newAutos;
+			}
+			memcpy(m->autos + m->automorphisms*m->size, perm, sizeof(int)*m->size);
+			m->automorphisms++;
+		}
+		else {
+			depth++;
+			perm[depth] = -1;
+		}
+	}
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Search plan for a motif: the first fixed vertices of order are given and the rest grow from the
+   highest degree vertex, always taking the vertex with the most links to those already in the
+   order so that candidates come from an anchor's neighbours. Fixed vertices have no anchor */
+static void mc_motif_plan (const mc_motif_t *m, int fixed, int *order, int *anchor,
+									igraph_bool_t *anchorOut)
+{
+	int u, v, i, d, best, bestLinks, links, degree[MC_MAX_MOTIF], matched[MC_MAX_MOTIF];
+
+	for (u=0; u<m->size; u++) {
+		degree[u] = 0;
+		for (v=0; v<m->size; v++) {
+			degree[u] += m->adj[u][v] + m->adj[v][u];
+		}
+	}
+
+	memset(matched, 0, sizeof(matched));
+	for (d=0; d<m->size; d++) {
+		if (d < fixed) {
+			matched[order[d]] = 1;
+			anchor[d] = -1;
+			anchorOut[d] = 1;
+			continue;
+		}
+		best = -1;
+		bestLinks = -1;
+		for (u=0; u<m->size; u++) {
+			if (matched[u] != 0) continue;
+			links = 0;
+			for (i=0; i<d; i++) {
+				links += m->adj[u][order[i]] + m->adj[order[i]][u];
+			}
+			if (links > bestLinks || (links == bestLinks && degree[u] > degree[best])) {
+				best = u;
+				bestLinks = links;
+			}
+		}
+		order[d] = best;
+		matched[best] = 1;
+		anchor[d] = -1;
+		anchorOut[d] = 1;
+		for (i=0; i<d; i++) {
+			if (m->adj[order[i]][best] != 0) {
+				anchor[d] = order[i];
+				anchorOut[d] = 1;
+				break;
+			}
+			if (m->adj[best][order[i]] != 0) {
+				anchor[d] = order[i];
+				anchorOut[d] = 0;
+				break;
+			}
+		}
+	}
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_motif_init (mc_motif_t *m, const igraph_t *motif)
+{
+	long int e, i, s, groupSize;
+	int u, v, d, from, to;
+	long int *group;
+	igraph_bool_t inOrbit[MC_MAX_MOTIF];
+
+	memset(m, 0, sizeof(mc_motif_t));
+	m->size = (int)igraph_vcount(motif);
+	m->directed = igraph_is_directed(motif);
+	if (m->size < 1 || m->size > MC_MAX_MOTIF) {
+		return 1;
+	}
+
+	/* Adjacency matrix of the motif */
+	m->edges = 0;
+	for (e=0; e<(long int)igraph_ecount(motif); e++) {
+		from = (int)IGRAPH_FROM(motif, e);
+		to = (int)IGRAPH_TO(motif, e);
+		if (from == to || m->adj[from][to] != 0) {
+			continue;
+		}
+		m->adj[from][to] = 1;
+		if (m->directed == 0) {
+			m->adj[to][from] = 1;
+		}
+		m->from[m->edges] = from;
+		m->to[m->edges] = to;
+		m->edges++;
+	}
+
+	if (mc_motif_automorphisms(m) != 0) {
+		return 1;
+	}
+
+	/* Search order and anchors */
+	mc_motif_plan(m, 0, m->order, m->anchor, m->anchorOut);
+
+	/* Symmetry breaking (Grochow and Kellis, 2007): repeatedly take a vertex with a non-trivial
+	   orbit under the remaining automorphisms, require it to map to the lowest graph vertex of its
+	   orbit and then keep only the automorphisms that fix it */
+	group = (long int *)malloc(sizeof(long int)*m->automorphisms);
+	if (group == NULL) {
+		return 1;
+	}
+	groupSize = m->automorphisms;
+	for (s=0; s<groupSize; s++) {
+		group[s] = s;
+	}
+	m->constraints = 0;
+	for (d=0; d<m->size && groupSize > 1; d++) {
+		u = m->order[d];
+		memset(inOrbit, 0, sizeof(inOrbit));
+		for (s=0; s<groupSize; s++) {
+			inOrbit[m->autos[group[s]*m->size + u]] = 1;
+		}
+		for (v=0; v<m->size; v++) {
+			if (v != u && inOrbit[v] != 0) {
+				m->less[m->constraints] = u;
+				m->greater[m->constraints] = v;
+				m->constraints++;
+			}
+		}
+		/* Stabiliser of u */
+		i = 0;
+		for (s=0; s<groupSize; s++) {
+			if (m->autos[group[s]*m->size + u] == u) {
+				group[i] = group[s];
+				i++;
+			}
+		}
+		groupSize = i;
+	}
+	free(group);
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void mc_motif_destroy (mc_motif_t *m)
+{
+	free(m->autos);
+	m->autos = NULL;
+	m->automorphisms = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* State of a motif search */
+typedef struct {
+	const mc_graph_t *graph;
+	const mc_motif_t *motif;
+	igraph_bool_t canonical;
+	igraph_bool_t induced;       /* Only extend mappings that induce the motif (see below) */
+	int order[MC_MAX_MOTIF];     /* Search plan (the motif's own unless vertices are seeded) */
+	int anchor[MC_MAX_MOTIF];
+	igraph_bool_t anchorOut[MC_MAX_MOTIF];
+	int depthOf[MC_MAX_MOTIF];
+	int seeds;                   /* Depths with a fixed graph vertex ... */
+	int seed[MC_MAX_MOTIF];      /* ... and those vertices */
+	int map[MC_MAX_MOTIF];
+	mc_visit_t *visit;           /* Visitor for each mapping, NULL to only count them */
+	void *arg;
+	long int count;              /* Number of complete mappings found */
+	igraph_bool_t stop;
+} mc_search_t;
+
+/* Check that graph vertex c can take the motif vertex at depth d (edges to earlier vertices must
+   exist and the mapping must stay injective). For induced searches the pairs with the earlier
+   vertices must match the motif exactly, as in mc_motif_induced, so partial mappings that can
+   never be proper motifs are cut as early as possible */
+static igraph_bool_t mc_search_feasible (const mc_search_t *st, int d, int c)
+{
+	const mc_motif_t *m = st->motif;
+	int i, u, w;
+
+	u = st->order[d];
+	if (st->induced != 0 && st->graph->loops[c] != 0) {
+		return 0;
+	}
+	for (i=0; i<d; i++) {
+		w = st->order[i];
+		if (st->map[w] == c) {
+			return 0;
+		}
+		if (st->induced != 0) {
+			if (mc_graph_multiplicity(st->graph, st->map[w], c) != (int)m->adj[w][u] ||
+				 (m->directed != 0 &&
+				  mc_graph_multiplicity(st->graph, c, st->map[w]) != (int)m->adj[u][w])) {
+				return 0;
+			}
+			continue;
+		}
+		/* The edge between the anchor and u is guaranteed by how candidates are generated */
+		if (m->adj[w][u] != 0 && (w != st->anchor[d] || st->anchorOut[d] == 0) &&
+			 mc_graph_has_edge(st->graph, st->map[w], c) == 0) {
+			return 0;
+		}
+		if (m->directed != 0 && m->adj[u][w] != 0 && (w != st->anchor[d] || st->anchorOut[d] != 0) &&
+			 mc_graph_has_edge(st->graph, c, st->map[w]) == 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* Extend a partial mapping by matching the motif vertex at depth d */
+static void mc_search_extend (mc_search_t *st, int d)
+{
+	const mc_motif_t *m = st->motif;
+	const mc_list_t *list;
+	const int *cands;
+	long int p, candCount;
+	int u, a, c, k, lo, hi;
+
+	if (d == m->size) {
+		st->count++;
+		if (st->visit != NULL && st->visit(st->map, st->arg) == 0) {
+			st->stop = 1;
+		}
+		return;
+	}
+
+	/* Bounds on the graph vertex from the symmetry breaking constraints */
+	u = st->order[d];
+	lo = -1;
+	hi = (int)st->graph->nodes;
+	if (st->canonical != 0) {
+		for (k=0; k<m->constraints; k++) {
+			if (m->greater[k] == u && st->depthOf[m->less[k]] < d && st->map[m->less[k]] > lo) {
+				lo = st->map[m->less[k]];
+			}
+			if (m->less[k] == u && st->depthOf[m->greater[k]] < d && st->map[m->greater[k]] < hi) {
+				hi = st->map[m->greater[k]];
+			}
+		}
+	}
+
+	/* Candidates are the seed, the neighbours of the anchor or every vertex for a new component */
+	a = st->anchor[d];
+	if (d < st->seeds) {
+		cands = &st->seed[d];
+		candCount = 1;
+	}
+	else if (a >= 0) {
+		list = (st->anchorOut[d] != 0) ? &st->graph->out[st->map[a]] : &st->graph->in[st->map[a]];
+		cands = list->neis;
+		candCount = list->size;
+	}
+	else {
+		cands = NULL;
+		candCount = st->graph->nodes;
+	}
+
+	/* Lists are sorted so the bounds can cut the scan short */
+	for (p=0; p<candCount && st->stop == 0; p++) {
+		c = (cands != NULL) ? cands[p] : (int)p;
+		if (c <= lo) continue;
+		if (c >= hi) break;
+		if (mc_search_feasible(st, d, c) != 0) {
+			st->map[u] = c;
+			mc_search_extend(st, d+1);
+		}
+	}
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Run a motif search from an empty mapping, returning the number of mappings found */
+static long int mc_search_run (const mc_graph_t *g, const mc_motif_t *m, igraph_bool_t canonical,
+										 igraph_bool_t induced, mc_visit_t *visit, void *arg)
+{
+	mc_search_t st;
+	int d;
+
+	st.graph = g;
+	st.motif = m;
+	st.canonical = canonical;
+	st.induced = induced;
+	st.visit = visit;
+	st.arg = arg;
+	st.count = 0;
+	st.stop = 0;
+	st.seeds = 0;
+	memcpy(st.order, m->order, sizeof(st.order));
+	memcpy(st.anchor, m->anchor, sizeof(st.anchor));
+	memcpy(st.anchorOut, m->anchorOut, sizeof(st.anchorOut));
+	for (d=0; d<m->size; d++) {
+		st.depthOf[st.order[d]] = d;
+		st.map[d] = -1;
+	}
+
+	if (m->size <= g->nodes) {
+		mc_search_extend(&st, 0);
+	}
+
+	return st.count;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_motif_enumerate (const mc_graph_t *g, const mc_motif_t *m, igraph_bool_t canonical,
+								mc_visit_t *visit, void *arg)
+{
+	mc_search_run(g, m, canonical, 0, visit, arg);
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+igraph_bool_t mc_motif_induced (const mc_graph_t *g, const mc_motif_t *m, const int *map)
+{
+	int i, j;
+
+	for (i=0; i<m->size; i++) {
+		if (g->loops[map[i]] != 0) {
+			return 0;
+		}
+		/* Undirected pairs only need checking once */
+		for (j=(g->directed != 0) ? 0 : i+1; j<m->size; j++) {
+			if (i != j && mc_graph_multiplicity(g, map[i], map[j]) != (int)m->adj[i][j]) {
+				return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Triangles of an undirected graph, found by intersecting ordered neighbour lists */
+static long int mc_count_triangles (const mc_graph_t *g)
+{
+	const mc_list_t *vList, *uList;
+	long int v, p, q, r, count;
+	int u;
+
+	count = 0;
+	for (v=0; v<g->nodes; v++) {
+		vList = &g->out[v];
+		for (p=0; p<vList->size; p++) {
+			u = vList->neis[p];
+			if (u <= v) continue;
+			/* Common neighbours w > u of v and u */
+			uList = &g->out[u];
+			q = p+1;
+			r = 0;
+			while (q < vList->size && r < uList->size) {
+				if (vList->neis[q] < uList->neis[r]) q++;
+				else if (uList->neis[r] < vList->neis[q]) r++;
+				else {
+					count++;
+					q++;
+					r++;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Closed forms for the undirected motifs that have one (paths of 2 and 3 edges, the triangle and
+   the 3-star), counting copies of the motif edges in the same way as the enumeration. Returns -1
+   for other motifs */
+static long int mc_count_closed (const mc_graph_t *g, const mc_motif_t *m)
+{
+	long int v, p, deg, uDeg, count;
+	int u, w, d, maxDeg;
+
+	if (g->directed != 0 || m->size < 3 || m->size > 4) {
+		return -1;
+	}
+	for (d=1; d<m->size; d++) {
+		if (m->anchor[d] < 0) {
+			/* Disconnected motif */
+			return -1;
+		}
+	}
+	maxDeg = 0;
+	for (u=0; u<m->size; u++) {
+		deg = 0;
+		for (w=0; w<m->size; w++) {
+			deg += m->adj[u][w];
+		}
+		if (deg > maxDeg) maxDeg = (int)deg;
+	}
+
+	if (m->size == 3 && m->edges == 3) {
+		return mc_count_triangles(g);
+	}
+	if (m->edges != m->size-1) {
+		return -1;
+	}
+
+	count = 0;
+	if (maxDeg == m->size-1) {
+		/* Stars: choose the leaves from the neighbours of the centre */
+		for (v=0; v<g->nodes; v++) {
+			deg = g->out[v].size;
+			count += (m->size == 3) ? deg*(deg-1)/2 : deg*(deg-1)*(deg-2)/6;
+		}
+		return count;
+	}
+
+	/* Path of 3 edges: extend each middle edge at both ends, less the 3 closed ones per triangle */
+	for (v=0; v<g->nodes; v++) {
+		deg = g->out[v].size;
+		for (p=0; p<deg; p++) {
+			u = g->out[v].neis[p];
+			if (u <= v) continue;
+			uDeg = g->out[u].size;
+			count += (deg-1)*(uDeg-1);
+		}
+	}
+	return count - 3*mc_count_triangles(g);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+long int mc_motif_count (const mc_graph_t *g, const mc_motif_t *m)
+{
+	long int count;
+
+	count = mc_count_closed(g, m);
+	if (count >= 0) {
+		return count;
+	}
+
+	/* Directed motifs must be induced, which is checked as the search goes */
+	return mc_search_run(g, m, 1, g->directed, NULL, NULL);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* State of a local motif count */
+typedef struct {
+	const mc_graph_t *graph;
+	const mc_motif_t *motif;
+	long int *keys;        /* Sorted keys of the vertex pairs (and directed self-loop vertices) */
+	long int keyCount;
+	long int current;      /* Key being searched from */
+	long int count;        /* Mappings found, each instance once for every automorphism */
+} mc_local_t;
+
+/* Key of an unordered vertex pair, u == v for a single vertex */
+static long int mc_local_key (const mc_graph_t *g, int u, int v)
+{
+	return (u < v) ? (long int)u*g->nodes + v : (long int)v*g->nodes + u;
+}
+
+/* Compare two keys (for qsort) */
+static int mc_compare_long (const void *a, const void *b)
+{
+	long int x = *(const long int *)a, y = *(const long int *)b;
+	return (x > y) - (x < y);
+}
+
+/* Position of a key or -1 */
+static long int mc_local_find (const mc_local_t *lc, long int key)
+{
+	long int lo = 0, hi = lc->keyCount - 1, mid;
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (lc->keys[mid] == key) return mid;
+		if (lc->keys[mid] < key) lo = mid + 1;
+		else hi = mid - 1;
+	}
+	return -1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Visitor keeping a mapping only when it is found from the first key its vertex set holds, so
+   instances holding several keys are only counted once */
+static igraph_bool_t mc_local_visit (const int *map, void *arg)
+{
+	mc_local_t *lc = (mc_local_t *)arg;
+	long int pos;
+	int i, j;
+
+	for (i=0; i<lc->motif->size; i++) {
+		for (j=(lc->graph->directed != 0) ? i : i+1; j<lc->motif->size; j++) {
+			pos = mc_local_find(lc, mc_local_key(lc->graph, map[i], map[j]));
+			if (pos >= 0 && pos < lc->current) {
+				return 1;
+			}
+		}
+	}
+	lc->count++;
+	return 1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+long int mc_motif_count_local (const mc_graph_t *g, const mc_motif_t *m, const int *from,
+										 const int *to, long int edges)
+{
+	mc_local_t lc;
+	mc_search_t st;
+	long int e, k;
+	int a, b, d, u, v;
+
+	lc.graph = g;
+	lc.motif = m;
+	lc.count = 0;
+	lc.keys = (long int *)malloc(sizeof(long int)*(edges > 0 ? edges : 1));
+	if (lc.keys == NULL) {
+		return -1;
+	}
+
+	/* Self-loops only matter for directed graphs (where they stop a motif being proper) */
+	lc.keyCount = 0;
+	for (e=0; e<edges; e++) {
+		if (from[e] != to[e] || g->directed != 0) {
+			lc.keys[lc.keyCount++] = mc_local_key(g, from[e], to[e]);
+		}
+	}
+	qsort(lc.keys, lc.keyCount, sizeof(long int), mc_compare_long);
+	k = 0;
+	for (e=0; e<lc.keyCount; e++) {
+		if (e == 0 || lc.keys[e] != lc.keys[e-1]) {
+			lc.keys[k++] = lc.keys[e];
+		}
+	}
+	lc.keyCount = k;
+
+	st.graph = g;
+	st.motif = m;
+	st.canonical = 0;
+	st.induced = g->directed;
+	st.visit = mc_local_visit;
+	st.arg = &lc;
+	st.stop = 0;
+
+	/* Seed every motif vertex (pair) with each key's vertex (pair), so that every mapping holding
+	   the key is found exactly once */
+	for (lc.current=0; lc.current<lc.keyCount; lc.current++) {
+		u = (int)(lc.keys[lc.current] / g->nodes);
+		v = (int)(lc.keys[lc.current] % g->nodes);
+		st.seed[0] = u;
+		st.seed[1] = v;
+		st.seeds = (u == v) ? 1 : 2;
+		for (a=0; a<m->size; a++) {
+			for (b=0; b<m->size; b++) {
+				if ((st.seeds == 1 && b > 0) || (st.seeds == 2 && a == b)) continue;
+				st.order[0] = a;
+				st.order[1] = b;
+				mc_motif_plan(m, st.seeds, st.order, st.anchor, st.anchorOut);
+				for (d=0; d<m->size; d++) {
+					st.depthOf[st.order[d]] = d;
+					st.map[d] = -1;
+				}
+				mc_search_extend(&st, 0);
+			}
+		}
+	}
+
+	free(lc.keys);
+	return lc.count / m->automorphisms;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Instances holding a vertex, each kept as its sorted vertex set padded to MC_MAX_MOTIF entries */
+typedef struct {
+	int size;            /* Number of vertices in each instance */
+	int *sets;           /* Vertex sets found */
+	long int count;      /* Number of sets */
+	long int capacity;   /* Room allocated for sets */
+	igraph_bool_t failed;
+} mc_vertex_visit_t;
+
+/* Visitor keeping the vertex set of every mapping */
+static igraph_bool_t mc_vertex_visit (const int *map, void *arg)
+{
+	mc_vertex_visit_t *vv = (mc_vertex_visit_t *)arg;
+	int *sets, *set;
+	int i, j, v;
+
+	if (vv->count == vv->capacity) {
+		vv->capacity = (vv->capacity == 0) ? 64 : 2*vv->capacity;
+		sets = (int *)realloc(vv->sets, sizeof(int)*MC_MAX_MOTIF*vv->capacity);
+		if (sets == NULL) {
+			vv->failed = 1;
+			return 0;
+		}
+		vv->sets = sets;
+	}
+	set = vv->sets + vv->count*MC_MAX_MOTIF;
+	for (i=0; i<vv->size; i++) {
+		v = map[i];
+		for (j=i; j>0 && set[j-1] > v; j--) {
+			set[j] = set[j-1];
+		}
+		set[j] = v;
+	}
+	for (i=vv->size; i<MC_MAX_MOTIF; i++) {
+		set[i] = -1;
+	}
+	vv->count++;
+	return 1;
+}
+
+/* Compare two padded vertex sets (for qsort, any total order groups equal sets together) */
+static int mc_compare_sets (const void *a, const void *b)
+{
+	return memcmp(a, b, sizeof(int)*MC_MAX_MOTIF);
+}
+
+long int mc_motif_vertex_pairs (const mc_graph_t *g, const mc_motif_t *m, int v)
+{
+	mc_vertex_visit_t vv;
+	mc_search_t st;
+	long int i, run, pairs;
+	int a, d;
+
+	/* Proper motifs of directed graphs are induced, so instances with the same vertex set are
+	   automorphic and only one of them is visited; only undirected ones need their sets kept */
+	vv.size = m->size;
+	vv.sets = NULL;
+	vv.count = 0;
+	vv.capacity = 0;
+	vv.failed = 0;
+	st.graph = g;
+	st.motif = m;
+	st.canonical = 1;
+	st.induced = g->directed;
+	st.visit = (g->directed != 0) ? NULL : mc_vertex_visit;
+	st.arg = &vv;
+	st.count = 0;
+	st.stop = 0;
+
+	/* The symmetry breaking constraints hold for complete mappings whatever the search order, so
+	   seeding each motif vertex in turn with v finds every instance holding v exactly once */
+	st.seeds = 1;
+	st.seed[0] = v;
+	for (a=0; a<m->size && st.stop == 0; a++) {
+		st.order[0] = a;
+		mc_motif_plan(m, 1, st.order, st.anchor, st.anchorOut);
+		for (d=0; d<m->size; d++) {
+			st.depthOf[st.order[d]] = d;
+			st.map[d] = -1;
+		}
+		mc_search_extend(&st, 0);
+	}
+	if (vv.failed != 0) {
+		free(vv.sets);
+		return -1;
+	}
+
+	pairs = st.count*(st.count-1)/2;
+	if (vv.count > 1) {
+		qsort(vv.sets, vv.count, sizeof(int)*MC_MAX_MOTIF, mc_compare_sets);
+		run = 1;
+		for (i=1; i<=vv.count; i++) {
+			if (i < vv.count && mc_compare_sets(vv.sets + i*MC_MAX_MOTIF,
+															vv.sets + (i-1)*MC_MAX_MOTIF) == 0) {
+				run++;
+				continue;
+			}
+			pairs -= run*(run-1)/2;
+			run = 1;
+		}
+	}
+	free(vv.sets);
+	return pairs;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Number of isomorphism classes igraph has for each motif size (directed, undirected) */
+static const long int mc_isoclass_counts[2][5] = {{0, 0, 0, 4, 11}, {0, 0, 0, 16, 218}};
+
+/* Position of the first code bit of the pairs between vertex j and the vertices before it */
+static int mc_code_offset (int j, igraph_bool_t directed)
+{
+	return (directed != 0) ? j*(j-1) : j*(j-1)/2;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_isoclass_init (mc_isoclass_t *ic, int size, igraph_bool_t directed)
+{
+	igraph_t motif;
+	unsigned char adj[MC_MAX_MOTIF][MC_MAX_MOTIF];
+	int perm[MC_MAX_MOTIF], i, j, bit;
+	long int id, e, t, x, tuples, used, code;
+
+	ic->size = size;
+	ic->directed = directed;
+	ic->classOf = NULL;
+	if (size < 3 || size > 4) {
+		return 1;
+	}
+	ic->classes = mc_isoclass_counts[directed != 0][size];
+	ic->codes = 1L << ((directed != 0) ? size*(size-1) : size*(size-1)/2);
+	ic->classOf = (int *)malloc(sizeof(int)*ic->codes);
+	if (ic->classOf == NULL) {
+		return 1;
+	}
+
+	tuples = 1;
+	for (i=0; i<size; i++) {
+		tuples *= size;
+	}
+	for (id=0; id<ic->classes; id++) {
+		igraph_isoclass_create(&motif, size, (igraph_integer_t)id, directed);
+		memset(adj, 0, sizeof(adj));
+		for (e=0; e<(long int)igraph_ecount(&motif); e++) {
+			adj[(int)IGRAPH_FROM(&motif, e)][(int)IGRAPH_TO(&motif, e)] = 1;
+			if (directed == 0) {
+				adj[(int)IGRAPH_TO(&motif, e)][(int)IGRAPH_FROM(&motif, e)] = 1;
+			}
+		}
+		igraph_destroy(&motif);
+
+		/* Every labelling of the class (vertex i of a set being perm[i] of the class) */
+		for (t=0; t<tuples; t++) {
+			x = t;
+			used = 0;
+			for (i=0; i<size; i++) {
+				perm[i] = (int)(x % size);
+				x /= size;
+				used |= 1L << perm[i];
+			}
+			if (used != (1L << size) - 1) {
+				continue;
+			}
+			code = 0;
+			for (j=1; j<size; j++) {
+				bit = mc_code_offset(j, directed);
+				for (i=0; i<j; i++) {
+					if (directed != 0) {
+						code |= (long int)adj[perm[i]][perm[j]] << bit;
+						code |= (long int)adj[perm[j]][perm[i]] << (bit+1);
+						bit += 2;
+					}
+					else {
+						code |= (long int)adj[perm[i]][perm[j]] << bit;
+						bit++;
+					}
+				}
+			}
+			ic->classOf[code] = (int)id;
+		}
+	}
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void mc_isoclass_destroy (mc_isoclass_t *ic)
+{
+	free(ic->classOf);
+	ic->classOf = NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* State of the connected subgraph enumeration */
+typedef struct {
+	const mc_graph_t *graph;      /* Graph being searched */
+	int size;                     /* Number of vertices in each subgraph */
+	igraph_bool_t simple;         /* Skip sets with multiple edges or self-loops */
+	int set[MC_MAX_MOTIF];        /* Current vertex set */
+	long int code[MC_MAX_MOTIF];  /* Adjacency code of set[0..d] */
+	int *mark;                    /* Number of set vertices each vertex is in or next to */
+	int *ext;                     /* Extension candidates for each depth */
+	long int extSize;             /* Room for the candidates of one depth */
+	mc_subgraph_visit_t *visit;   /* Visitor for each subgraph */
+	void *arg;                    /* Argument passed to the visitor */
+	igraph_bool_t stop;           /* Set when the visitor stops the enumeration */
+} mc_subgraph_t;
+
+/* Code bits of the pairs between set[j] and the vertices before it, -1 if the pairs are not
+   simple and only simple sets are wanted */
+static long int mc_subgraph_pairs (const mc_subgraph_t *st, int j)
+{
+	const mc_graph_t *g = st->graph;
+	long int code;
+	int i, bit, mult;
+
+	if (st->simple != 0 && g->loops[st->set[j]] != 0) {
+		return -1;
+	}
+	code = 0;
+	bit = 0;
+	for (i=0; i<j; i++) {
+		mult = mc_graph_multiplicity(g, st->set[i], st->set[j]);
+		if (st->simple != 0 && mult > 1) return -1;
+		if (mult > 0) code |= 1L << bit;
+		bit++;
+		if (g->directed != 0) {
+			mult = mc_graph_multiplicity(g, st->set[j], st->set[i]);
+			if (st->simple != 0 && mult > 1) return -1;
+			if (mult > 0) code |= 1L << bit;
+			bit++;
+		}
+	}
+	return code;
+}
+
+/* Add or remove a vertex's closed neighbourhood from the marks */
+static void mc_subgraph_mark (mc_subgraph_t *st, int w, int delta)
+{
+	const mc_graph_t *g = st->graph;
+	long int p;
+
+	st->mark[w] += delta;
+	for (p=0; p<g->out[w].size; p++) {
+		st->mark[g->out[w].neis[p]] += delta;
+	}
+	if (g->directed != 0) {
+		for (p=0; p<g->in[w].size; p++) {
+			st->mark[g->in[w].neis[p]] += delta;
+		}
+	}
+}
+
+/* ESU extension of the connected set set[0..d-1] with the candidates ext[0..n-1]: every candidate
+   is tried in turn, followed by the later candidates and its neighbours that are not next to the
+   set, so each connected set is reached exactly once */
+static void mc_subgraph_extend (mc_subgraph_t *st, int d, const int *ext, long int n)
+{
+	const mc_graph_t *g = st->graph;
+	long int i, p, next, pairs;
+	int w, u, *newExt;
+
+	newExt = st->ext + d*st->extSize;
+	for (i=0; i<n && st->stop == 0; i++) {
+		w = ext[i];
+		st->set[d] = w;
+		pairs = mc_subgraph_pairs(st, d);
+		if (pairs < 0) {
+			/* No superset can be simple */
+			continue;
+		}
+		st->code[d] = st->code[d-1] | (pairs << mc_code_offset(d, g->directed));
+
+		if (d == st->size-1) {
+			if (st->visit(st->set, st->code[d], st->arg) == 0) {
+				st->stop = 1;
+			}
+			continue;
+		}
+
+		/* Remaining candidates and the exclusive neighbours of w */
+		next = 0;
+		for (p=i+1; p<n; p++) {
+			newExt[next++] = ext[p];
+		}
+		for (p=0; p<g->out[w].size; p++) {
+			u = g->out[w].neis[p];
+			if (u > st->set[0] && st->mark[u] == 0) {
+				newExt[next++] = u;
+			}
+		}
+		if (g->directed != 0) {
+			for (p=0; p<g->in[w].size; p++) {
+				u = g->in[w].neis[p];
+				if (u > st->set[0] && st->mark[u] == 0 && mc_graph_has_edge(g, w, u) == 0) {
+					newExt[next++] = u;
+				}
+			}
+		}
+
+		mc_subgraph_mark(st, w, 1);
+		mc_subgraph_extend(st, d+1, newExt, next);
+		mc_subgraph_mark(st, w, -1);
+	}
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_subgraph_enumerate (const mc_graph_t *g, int size, igraph_bool_t simple,
+									mc_subgraph_visit_t *visit, void *arg)
+{
+	mc_subgraph_t st;
+	long int v, p, n, deg, maxDeg;
+	int u, *first;
+
+	if (size < 2 || size > MC_MAX_MOTIF) {
+		return 1;
+	}
+	st.graph = g;
+	st.size = size;
+	st.simple = simple;
+	st.visit = visit;
+	st.arg = arg;
+	st.stop = 0;
+
+	/* Candidates never number more than the neighbours of the set's vertices */
+	maxDeg = 0;
+	for (v=0; v<g->nodes; v++) {
+		deg = g->out[v].size + ((g->directed != 0) ? g->in[v].size : 0);
+		if (deg > maxDeg) maxDeg = deg;
+	}
+	st.extSize = size*maxDeg + 1;
+	st.ext = (int *)malloc(sizeof(int)*st.extSize*size);
+	st.mark = (int *)calloc(g->nodes > 0 ? g->nodes : 1, sizeof(int));
+	if (st.ext == NULL || st.mark == NULL) {
+		free(st.ext);
+		free(st.mark);
+		return 1;
+	}
+
+	/* Each set is grown from its smallest vertex, starting with the neighbours after it */
+	first = st.ext;
+	for (v=0; v<g->nodes && st.stop == 0; v++) {
+		if (simple != 0 && g->loops[v] != 0) {
+			continue;
+		}
+		st.set[0] = (int)v;
+		st.code[0] = 0;
+		n = 0;
+		for (p=0; p<g->out[v].size; p++) {
+			u = g->out[v].neis[p];
+			if (u > v) first[n++] = u;
+		}
+		if (g->directed != 0) {
+			for (p=0; p<g->in[v].size; p++) {
+				u = g->in[v].neis[p];
+				if (u > v && mc_graph_has_edge(g, (int)v, u) == 0) first[n++] = u;
+			}
+		}
+		mc_subgraph_mark(&st, (int)v, 1);
+		mc_subgraph_extend(&st, 1, first, n);
+		mc_subgraph_mark(&st, (int)v, -1);
+	}
+
+	free(st.ext);
+	free(st.mark);
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_overlap_init (mc_overlap_t *ov, long int size, long int nodes)
+{
+	ov->size = size;
+	ov->nodes = nodes;
+	ov->count = 0;
+	ov->capacity = 0;
+	ov->verts = NULL;
+	ov->offsets = NULL;
+	ov->insts = NULL;
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_overlap_add (mc_overlap_t *ov, const int *map)
+{
+	long int k, newCap;
+	int *newVerts;
+
+	/* Grow the instance rows geometrically */
+	if (ov->count == ov->capacity) {
+		newCap = (ov->capacity == 0) ? 1024 : ov->capacity*2;
+		newVerts = (int *)realloc(ov->verts, sizeof(int)*newCap*ov->size);
+		if (newVerts == NULL) {
+			return 1;
+		}
+		ov->verts = newVerts;
+		ov->capacity = newCap;
+	}
+
+	for (k=0; k<ov->size; k++) {
+		ov->verts[ov->count*ov->size + k] = map[k];
+	}
+	ov->count++;
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_overlap_build (mc_overlap_t *ov)
+{
+	long int i, v, total;
+	long int *fill;
+
+	total = ov->count*ov->size;
+	ov->offsets = (long int *)calloc(ov->nodes+1, sizeof(long int));
+	ov->insts = (long int *)malloc(sizeof(long int)*(total > 0 ? total : 1));
+	fill = (long int *)malloc(sizeof(long int)*(ov->nodes > 0 ? ov->nodes : 1));
+	if (ov->offsets == NULL || ov->insts == NULL || fill == NULL) {
+		free(fill);
+		return 1;
+	}
+
+	/* Count the instances at each vertex and convert to offsets */
+	for (i=0; i<total; i++) {
+		ov->offsets[ov->verts[i]+1]++;
+	}
+	for (v=0; v<ov->nodes; v++) {
+		ov->offsets[v+1] += ov->offsets[v];
+		fill[v] = ov->offsets[v];
+	}
+
+	/* Fill the lists in instance order so each one is ascending */
+	for (i=0; i<total; i++) {
+		v = ov->verts[i];
+		ov->insts[fill[v]] = i / ov->size;
+		fill[v]++;
+	}
+
+	free(fill);
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+long int mc_overlap_shared (const mc_overlap_t *ov)
+{
+	long int i, j, k, v, p, touchedCount, totShared;
+	long int *cursor, *touched;
+	unsigned char *hits;
+
+	if (ov->count < 2) {
+		return 0;
+	}
+
+	cursor = (long int *)malloc(sizeof(long int)*(ov->nodes > 0 ? ov->nodes : 1));
+	touched = (long int *)malloc(sizeof(long int)*ov->count);
+	hits = (unsigned char *)calloc(ov->count, sizeof(unsigned char));
+	if (cursor == NULL || touched == NULL || hits == NULL) {
+		free(cursor);
+		free(touched);
+		free(hits);
+		return -1;
+	}
+	memcpy(cursor, ov->offsets, sizeof(long int)*ov->nodes);
+
+	totShared = 0;
+	for (i=0; i<ov->count; i++) {
+
+		/* Instances are visited in ascending order so each vertex cursor points at instance i;
+		   everything after it in the list is a later instance sharing that vertex */
+		touchedCount = 0;
+		for (k=0; k<ov->size; k++) {
+			v = ov->verts[i*ov->size + k];
+			for (p=cursor[v]+1; p<ov->offsets[v+1]; p++) {
+				j = ov->insts[p];
+				if (hits[j] == 0) {
+					touched[touchedCount] = j;
+					touchedCount++;
+				}
+				hits[j]++;
+			}
+			cursor[v]++;
+		}
+
+		/* Only partial overlaps count (full overlap is the same motif) and reset the hits */
+		for (p=0; p<touchedCount; p++) {
+			j = touched[p];
+			if ((long int)hits[j] < ov->size) {
+				totShared += (long int)hits[j];
+			}
+			hits[j] = 0;
+		}
+	}
+
+	free(cursor);
+	free(touched);
+	free(hits);
+	return totShared;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+long int mc_overlap_partners (const mc_overlap_t *ov, long int i, long int *partners,
+										unsigned char *marks)
+{
+	long int j, k, v, p, found;
+
+	/* Lists are ascending so the later instances are at the end of each one */
+	found = 0;
+	for (k=0; k<ov->size; k++) {
+		v = ov->verts[i*ov->size + k];
+		for (p=ov->offsets[v+1]-1; p>=ov->offsets[v] && ov->insts[p] > i; p--) {
+			j = ov->insts[p];
+			if (marks[j] == 0) {
+				marks[j] = 1;
+				partners[found++] = j;
+			}
+		}
+	}
+	for (p=0; p<found; p++) {
+		marks[partners[p]] = 0;
+	}
+	qsort(partners, found, sizeof(long int), mc_compare_long);
+	return found;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void mc_overlap_destroy (mc_overlap_t *ov)
+{
+	free(ov->verts);
+	free(ov->offsets);
+	free(ov->insts);
+	ov->verts = NULL;
+	ov->offsets = NULL;
+	ov->insts = NULL;
+	ov->count = 0;
+	ov->capacity = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int mc_vertex_sets_init (mc_vertex_sets_t *vs, int size, long int nodes)
+{
+	long int s;
+
+	vs->size = size;
+	vs->bits = 1;
+	while (vs->bits < 32 && (1L << vs->bits) < nodes) {
+		vs->bits++;
+	}
+	if (size*vs->bits > 64) {
+		vs->bits = 0;
+	}
+	vs->count = 0;
+	vs->capacity = 0;
+	vs->keys = NULL;
+	vs->verts = NULL;
+	vs->slotsMask = 1023;
+	vs->slots = (long int *)malloc(sizeof(long int)*(vs->slotsMask+1));
+	if (vs->slots == NULL) {
+		return 1;
+	}
+	for (s=0; s<=vs->slotsMask; s++) {
+		vs->slots[s] = -1;
+	}
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Slot of a key, either the one holding the set or the empty one where it belongs */
+static long int mc_vertex_sets_slot (const mc_vertex_sets_t *vs, unsigned long long key,
+												 const int *set)
+{
+	unsigned long long h;
+	long int s, e;
+
+	h = key * 0x9E3779B97F4A7C15ULL;
+	s = (long int)((h ^ (h >> 29)) & (unsigned long long)vs->slotsMask);
+	while ((e = vs->slots[s]) >= 0) {
+		if (vs->keys[e] == key && (vs->bits != 0 ||
+			 memcmp(vs->verts + e*vs->size, set, sizeof(int)*vs->size) == 0)) {
+			break;
+		}
+		s = (s + 1) & vs->slotsMask;
+	}
+	return s;
+}
+
+int mc_vertex_sets_add (mc_vertex_sets_t *vs, const int *map)
+{
+	int set[MC_MAX_MOTIF];
+	unsigned long long key, *keys;
+	long int i, s, *slots;
+	int j, v, *verts;
+
+	/* Sorted vertices (sets are small so insertion sort is enough) */
+	for (i=0; i<vs->size; i++) {
+		v = map[i];
+		for (j=(int)i; j>0 && set[j-1] > v; j--) {
+			set[j] = set[j-1];
+		}
+		set[j] = v;
+	}
+	key = 0ULL;
+	for (i=0; i<vs->size; i++) {
+		if (vs->bits != 0) {
+			key = (key << vs->bits) | (unsigned long long)set[i];
+		}
+		else {
+			key = (key ^ (unsigned long long)set[i]) * 0x100000001B3ULL;
+		}
+	}
+
+	s = mc_vertex_sets_slot(vs, key, set);
+	if (vs->slots[s] >= 0) {
+		return 0;
+	}
+
+	/* New set */
+	if (vs->count == vs->capacity) {
+		i = (vs->capacity == 0) ? 1024 : 2*vs->capacity;
+		keys = (unsigned long long *)realloc(vs->keys, sizeof(unsigned long long)*i);
+		if (keys == NULL) {
+			return -1;
+		}
+		vs->keys = keys;
+		if (vs->bits == 0) {
+			verts = (int *)realloc(vs->verts, sizeof(int)*vs->size*i);
+			if (verts == NULL) {
+				return -1;
+			}
+			vs->verts = verts;
+		}
+		vs->capacity = i;
+	}
+	vs->keys[vs->count] = key;
+	if (vs->bits == 0) {
+		memcpy(vs->verts + vs->count*vs->size, set, sizeof(int)*vs->size);
+	}
+	vs->slots[s] = vs->count++;
+
+	/* Keep the table at most half full */
+	if (2*vs->count > vs->slotsMask) {
+		slots = (long int *)malloc(sizeof(long int)*2*(vs->slotsMask+1));
+		if (slots == NULL) {
+			return -1;
+		}
+		free(vs->slots);
+		vs->slots = slots;
+		vs->slotsMask = 2*vs->slotsMask + 1;
+		for (s=0; s<=vs->slotsMask; s++) {
+			vs->slots[s] = -1;
+		}
+		for (i=0; i<vs->count; i++) {
+			vs->slots[mc_vertex_sets_slot(vs, vs->keys[i], (vs->bits != 0) ? NULL :
+													vs->verts + i*vs->size)] = i;
+		}
+	}
+	return 1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void mc_vertex_sets_destroy (mc_vertex_sets_t *vs)
+{
+	free(vs->keys);
+	free(vs->verts);
+	free(vs->slots);
+	vs->keys = NULL;
+	vs->verts = NULL;
+	vs->slots = NULL;
+	vs->count = 0;
+	vs->capacity = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
@@ -0,0 +1,237 @@
+/*===============================================================================================
+ *  mcmotif.h
+ *
+ *  Motif routines shared by the mctools command line applications (mcc, mcstats and
+ *  mcextract). Compile mcmotif.c alongside the application, e.g.
+ *
+ *     gcc -I INC_DIR -L LIB_DIR -O3 mcc.c mcmotif.c -ligraph -lstdc++ -o mcc -Wall
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#ifndef MCMOTIF_H
+#define MCMOTIF_H
+
+#include <igraph.h>
+
+/* Largest motif size supported by the motif descriptor and enumeration */
+#define MC_MAX_MOTIF 8
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Sorted neighbour list of a vertex with the number of edges to each neighbour. */
+typedef struct {
+	int *neis;           /* Neighbours in ascending order */
+	int *mult;           /* Number of edges to each neighbour */
+	long int size;       /* Number of neighbours */
+	long int capacity;   /* Room allocated for the list, 0 while it is held in the graph's block */
+} mc_list_t;
+
+/* Adjacency view of a graph used for motif enumeration. Duplicate edges are merged (their
+ * multiplicity is kept) and self-loops are only counted per vertex. For undirected graphs the
+ * in and out lists are the same. Edges can be added and removed after the view is built. */
+typedef struct {
+	long int nodes;          /* Number of vertices */
+	igraph_bool_t directed;  /* Directedness of the graph */
+	mc_list_t *out;          /* Out-neighbours of each vertex */
+	mc_list_t *in;           /* In-neighbours of each vertex */
+	int *loops;              /* Number of self-loops on each vertex */
+	int *outBlock;           /* Storage of the lists as built ... */
+	int *inBlock;            /* ... (lists move out when they grow) */
+} mc_graph_t;
+
+/* Build the view of an igraph graph. */
+int mc_graph_init (mc_graph_t *g, const igraph_t *graph);
+
+/* Build the view of a graph from an edge list (from[e] -> to[e]), NULL lists for no edges. Only
+ * plain memory is used, so (unlike mc_graph_init) it can be called from several threads. */
+int mc_graph_build (mc_graph_t *g, long int nodes, igraph_bool_t directed, const int *from,
+						  const int *to, long int edges);
+
+/* Check for an edge from -> to (either direction for undirected graphs). */
+igraph_bool_t mc_graph_has_edge (const mc_graph_t *g, int from, int to);
+
+/* Number of edges from -> to, 0 if there are none. */
+int mc_graph_multiplicity (const mc_graph_t *g, int from, int to);
+
+/* Add an edge from -> to. */
+int mc_graph_add_edge (mc_graph_t *g, int from, int to);
+
+/* Remove one edge from -> to, returns 1 if there is none. */
+int mc_graph_remove_edge (mc_graph_t *g, int from, int to);
+
+/* Free memory used by the view. */
+void mc_graph_destroy (mc_graph_t *g);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Motif descriptor holding the motif adjacency, its automorphism group and the search plan used
+ * when enumerating the motif in a graph. Symmetry breaking constraints of the form
+ * map[a] < map[b] are derived from the automorphism group so that the canonical enumeration
+ * gives exactly one mapping for each motif instance (rather than one for every automorphism). */
+typedef struct {
+	int size;                                  /* Number of vertices */
+	int edges;                                 /* Number of edges */
+	igraph_bool_t directed;                    /* Directedness of the motif */
+	unsigned char adj[MC_MAX_MOTIF][MC_MAX_MOTIF];  /* Adjacency matrix (adj[i][j] for i -> j) */
+	int from[MC_MAX_MOTIF*MC_MAX_MOTIF];       /* Edge list of the motif ... */
+	int to[MC_MAX_MOTIF*MC_MAX_MOTIF];         /* ... (in igraph edge order) */
+	long int automorphisms;                    /* Size of the automorphism group (rotSym) */
+	int *autos;                                /* Automorphisms, size entries per permutation */
+	int order[MC_MAX_MOTIF];                   /* Motif vertex matched at each search depth */
+	int anchor[MC_MAX_MOTIF];                  /* Earlier motif vertex adjacent to order[d] or -1 */
+	igraph_bool_t anchorOut[MC_MAX_MOTIF];     /* Candidates are out-neighbours of the anchor */
+	int constraints;                           /* Number of symmetry breaking constraints */
+	int less[MC_MAX_MOTIF*MC_MAX_MOTIF];       /* Constraint c requires map[less[c]] < ... */
+	int greater[MC_MAX_MOTIF*MC_MAX_MOTIF];    /* ... map[greater[c]] */
+} mc_motif_t;
+
+/* Build the descriptor for a motif graph (e.g. from igraph_isoclass_create). */
+int mc_motif_init (mc_motif_t *m, const igraph_t *motif);
+
+/* Free memory used by the descriptor. */
+void mc_motif_destroy (mc_motif_t *m);
+
+/* Visitor called for every mapping (motif vertex -> graph vertex) found by the enumeration. The
+ * mapping is only valid during the call. Return false to stop the enumeration early. */
+typedef igraph_bool_t mc_visit_t (const int *map, void *arg);
+
+/* Enumerate the mappings of a motif in a graph, calling a visitor for each one. Edges of the
+ * motif must be present in the graph, matching igraph_get_subisomorphisms_vf2(). If canonical is
+ * true only one mapping per motif instance is visited, otherwise all automorphic mappings are.
+ * Nothing is stored so memory use is independent of the number of mappings. */
+int mc_motif_enumerate (const mc_graph_t *g, const mc_motif_t *m, igraph_bool_t canonical,
+								mc_visit_t *visit, void *arg);
+
+/* Check that a mapping is a proper motif, i.e. that the subgraph it induces is exactly the motif:
+ * every ordered pair of mapped vertices must have one edge if the motif has that edge and none
+ * otherwise, and no mapped vertex may have a self-loop. This is equivalent to comparing the edge
+ * count of igraph_induced_subgraph() with the motif edges, but needs no allocation. */
+igraph_bool_t mc_motif_induced (const mc_graph_t *g, const mc_motif_t *m, const int *map);
+
+/* Count the instances of a motif in a graph: the canonical mappings that are proper motifs (see
+ * mc_motif_induced) for directed graphs and all canonical mappings for undirected ones, as the
+ * tools do. Undirected paths, stars and triangles of 3 and 4 vertices use closed forms over the
+ * vertex degrees. Other motifs are counted by the symmetry broken search, which for directed
+ * graphs only extends partial mappings that already induce the motif. No mappings are kept. */
+long int mc_motif_count (const mc_graph_t *g, const mc_motif_t *m);
+
+/* Count the instances of a motif (as counted by mc_motif_count) whose vertices include both ends
+ * of at least one of a set of edges, each instance only once. Adding or removing the edges can
+ * only change these instances, so the new total is the old total plus the difference of the
+ * local counts taken after and before the change. */
+long int mc_motif_count_local (const mc_graph_t *g, const mc_motif_t *m, const int *from,
+										 const int *to, long int edges);
+
+/* Number of pairs of motif instances (as counted by mc_motif_count) that both hold vertex v,
+ * excluding pairs that share all their vertices. Every pair counted by mc_overlap_shared shares
+ * each of its common vertices once, so summed over all vertices this is the total shared vertices
+ * of the instances, and a sample of vertices estimates it without keeping every instance. Only
+ * the instances holding v are searched for. Returns -1 on failure. */
+long int mc_motif_vertex_pairs (const mc_graph_t *g, const mc_motif_t *m, int v);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Adjacency codes of small vertex sets hold one bit per vertex pair in the order (0,1), (0,2),
+ * (1,2), (0,3), ... with i -> j before j -> i for directed graphs. The isoclass table maps every
+ * code of 3 or 4 vertices to its igraph isomorphism class (as igraph_isoclass would). */
+typedef struct {
+	int size;                /* Number of vertices */
+	igraph_bool_t directed;  /* Directedness of the classes */
+	long int classes;        /* Number of isomorphism classes */
+	long int codes;          /* Number of adjacency codes */
+	int *classOf;            /* Isomorphism class of each code */
+} mc_isoclass_t;
+
+/* Build the isoclass table for a motif size (3 or 4 vertices). */
+int mc_isoclass_init (mc_isoclass_t *ic, int size, igraph_bool_t directed);
+
+/* Free memory used by the table. */
+void mc_isoclass_destroy (mc_isoclass_t *ic);
+
+/* Visitor called for every connected vertex set found by mc_subgraph_enumerate with its
+ * adjacency code. The set is only valid during the call. Return false to stop early. */
+typedef igraph_bool_t mc_subgraph_visit_t (const int *set, long int code, void *arg);
+
+/* Enumerate every connected (ignoring direction) set of a number of vertices once using ESU
+ * (Wernicke 2006). If simple is true sets with self-loops or multiple edges between a pair of
+ * vertices are skipped, matching the proper motifs of directed graphs. */
+int mc_subgraph_enumerate (const mc_graph_t *g, int size, igraph_bool_t simple,
+									mc_subgraph_visit_t *visit, void *arg);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Vertex -> motif instance inverted index. Instances are held as rows of motif size vertex IDs
+ * and every vertex keeps the (ascending) list of instances it takes part in. Pairs of instances
+ * that share vertices can then be found without comparing every pair of instances. Until it is
+ * built the index is just the rows, a compact store for keeping mappings found by an enumeration
+ * (one allocation of plain ints rather than a vector per mapping). */
+typedef struct {
+	long int size;       /* Number of vertices in each instance */
+	long int nodes;      /* Number of vertices in the graph */
+	long int count;      /* Number of instances added */
+	long int capacity;   /* Number of instance rows allocated */
+	int *verts;          /* Instance vertex IDs, size entries per instance */
+	long int *offsets;   /* Start of each vertex's instance list (nodes+1 entries) */
+	long int *insts;     /* Instance lists for all vertices */
+} mc_overlap_t;
+
+/* Initialise an empty index for motifs of a given size in a graph with a number of nodes. */
+int mc_overlap_init (mc_overlap_t *ov, long int size, long int nodes);
+
+/* Add a motif instance (mapping of motif vertex -> graph vertex). */
+int mc_overlap_add (mc_overlap_t *ov, const int *map);
+
+/* Build the vertex -> instance lists once all instances have been added. */
+int mc_overlap_build (mc_overlap_t *ov);
+
+/* Total number of vertices shared between all pairs of instances, excluding pairs that share
+ * all their vertices. Only pairs that actually share a vertex are visited. */
+long int mc_overlap_shared (const mc_overlap_t *ov);
+
+/* Find the later instances (index above i) that share a vertex with instance i, in ascending
+ * order. partners needs room for count entries and marks must be count zeroed bytes, which are
+ * zeroed again on return. Returns the number of instances found. */
+long int mc_overlap_partners (const mc_overlap_t *ov, long int i, long int *partners,
+										unsigned char *marks);
+
+/* Free memory used by the index. */
+void mc_overlap_destroy (mc_overlap_t *ov);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Hash set of the vertex sets of motif instances, so the mappings of an instance found more than
+ * once (e.g. through its automorphisms) are kept only once in linear time. Sets are keyed by
+ * their sorted vertices, packed into 64 bits when they fit (e.g. 4 vertices of graphs with less
+ * than 65536 nodes) and otherwise hashed with the sorted vertices kept for comparison. */
+typedef struct {
+	int size;                  /* Number of vertices in each set */
+	int bits;                  /* Bits per vertex of packed keys, 0 if keys do not fit */
+	long int count;            /* Number of sets held */
+	long int capacity;         /* Room allocated for sets */
+	unsigned long long *keys;  /* Packed key (or hash) of each set */
+	int *verts;                /* Sorted vertices of each set (only when keys are hashed) */
+	long int *slots;           /* Hash table of sets by key (-1 for empty slots) */
+	long int slotsMask;        /* Number of slots minus one (a power of two) */
+} mc_vertex_sets_t;
+
+/* Initialise an empty set for instances of a size in a graph with a number of nodes. */
+int mc_vertex_sets_init (mc_vertex_sets_t *vs, int size, long int nodes);
+
+/* Add the vertex set of a mapping (motif vertex -> graph vertex). Returns 1 if the set is new, 0
+ * if it was already held and -1 if out of memory. */
+int mc_vertex_sets_add (mc_vertex_sets_t *vs, const int *map);
+
+/* Free memory used by the set. */
+void mc_vertex_sets_destroy (mc_vertex_sets_t *vs);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,189 @@
+/*===============================================================================================
+ *  mcregistry.c
+ *
+ *  Registry of motif descriptors shared by the mctools command line applications. See
+ *  mcregistry.h for details.
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mcregistry.h"
+
+/* Descriptors built so far */
+static mc_descriptor_t **mc_registry = NULL;
+static long int mc_registry_count = 0;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Number of isoclasses igraph has for motifs of a size, 0 if it has none */
+static int mc_registry_classes (int size, igraph_bool_t directed)
+{
+	if (size == 3) {
+		return (directed != 0) ? 16 : 4;
+	}
+	if (size == 4) {
+		return (directed != 0) ? 218 : 11;
+	}
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+unsigned long long mc_registry_code (const mc_motif_t *m)
+{
+	unsigned long long code;
+	int i, j;
+
+	code = 0;
+	for (i=0; i<m->size; i++) {
+		for (j=0; j<m->size; j++) {
+			if (m->adj[i][j] != 0) {
+				code |= 1ULL << (i*MC_MAX_MOTIF + j);
+			}
+		}
+	}
+	return code;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Add a descriptor for a motif graph, or find the one already held for it */
+static mc_descriptor_t *mc_registry_add (const igraph_t *graph, int isoclass)
+{
+	mc_descriptor_t *d, **registry;
+	long int i;
+
+	d = (mc_descriptor_t *)malloc(sizeof(mc_descriptor_t));
+	if (d == NULL) {
+		return NULL;
+	}
+	if (mc_motif_init(&d->motif, graph) != 0) {
+		free(d);
+		return NULL;
+	}
+	d->size = d->motif.size;
+	d->isoclass = isoclass;
+	d->directed = (d->motif.directed != 0);
+	d->code = mc_registry_code(&d->motif);
+	d->hasTypes = 0;
+	for (i=0; i<mc_registry_count; i++) {
+		if (mc_registry[i]->size == d->size && mc_registry[i]->directed == d->directed &&
+			 mc_registry[i]->code == d->code) {
+			mc_motif_destroy(&d->motif);
+			free(d);
+			return mc_registry[i];
+		}
+	}
+
+	registry = (mc_descriptor_t **)realloc(mc_registry,
+														sizeof(mc_descriptor_t *)*(mc_registry_count + 1));
+	if (registry == NULL) {
+		mc_motif_destroy(&d->motif);
+		free(d);
+		return NULL;
+	}
+	mc_registry = registry;
+	mc_registry[mc_registry_count++] = d;
+	return d;
+}
+
+mc_descriptor_t *mc_registry_motif (int size, int isoclass, igraph_bool_t directed)
+{
+	mc_descriptor_t *d;
+	igraph_t M;
+	long int i;
+
+	directed = (directed != 0);
+	if (isoclass < 0 || isoclass >= mc_registry_classes(size, directed)) {
+		return NULL;
+	}
+	for (i=0; i<mc_registry_count; i++) {
+		d = mc_registry[i];
+		if (d->size == size && d->isoclass == isoclass && d->directed == directed) {
+			return d;
+		}
+	}
+
+	/* New descriptor */
+	igraph_isoclass_create(&M, size, isoclass, directed);
+	d = mc_registry_add(&M, isoclass);
+	igraph_destroy(&M);
+	return d;
+}
+
+mc_descriptor_t *mc_registry_motif_graph (const igraph_t *motif)
+{
+	return mc_registry_add(motif, -1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+mc_cluster_types_t *mc_registry_cluster_types (mc_descriptor_t *d)
+{
+	const char *dir;
+	char filename[1024], tempname[1100];
+
+	if (d->hasTypes != 0) {
+		return &d->types;
+	}
+
+	/* Cached catalogue, otherwise built and saved (through a temporary file so that runs sharing
+	   the cache never read a partial one) */
+	dir = getenv(MC_REGISTRY_CACHE);
+	if (dir != NULL && dir[0] != '\0') {
+		if (d->isoclass >= 0) {
+			snprintf(filename, sizeof(filename), "%s/types_%i_%i_%c.bin", dir, d->size, d->isoclass,
+						(d->directed != 0) ? 'd' : 'u');
+		}
+		else {
+			snprintf(filename, sizeof(filename), "%s/types_%i_x%llx_%c.bin", dir, d->size, d->code,
+						(d->directed != 0) ? 'd' : 'u');
+		}
+		if (mc_cluster_types_read(&d->types, filename, d->size, d->directed, d->code) == 0) {
+			d->hasTypes = 1;
+			return &d->types;
+		}
+	}
+	if (mc_cluster_types_build(&d->types, &d->motif) != 0) {
+		return NULL;
+	}
+	d->hasTypes = 1;
+	if (dir != NULL && dir[0] != '\0') {
+		snprintf(tempname, sizeof(tempname), "%s.%li.tmp", filename, (long int)getpid());
+		if (mc_cluster_types_write(&d->types, tempname, d->code) != 0 || rename(tempname, filename) != 0) {
+			remove(tempname);
+		}
+	}
+	return &d->types;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void mc_registry_clear (void)
+{
+	long int i;
+
+	for (i=0; i<mc_registry_count; i++) {
+		mc_motif_destroy(&mc_registry[i]->motif);
+		if (mc_registry[i]->hasTypes != 0) {
+			mc_cluster_types_destroy(&mc_registry[i]->types);
+		}
+		free(mc_registry[i]);
+	}
+	free(mc_registry);
+	mc_registry = NULL;
+	mc_registry_count = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
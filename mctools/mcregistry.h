@@ -0,0 +1,72 @@
+/*===============================================================================================
+ *  mcregistry.h
+ *
+ *  Registry of motif descriptors shared by the mctools command line applications. Everything
+ *  derived from a motif alone (its edge list, automorphism group and symmetry breaking search plan
+ *  and its clustering types, see mcmotif.h and mccluster.h) depends only on the size, isoclass
+ *  and directedness of the motif, so it is built once and looked up by these three values (or by
+ *  the adjacency of motifs given as graphs, such as those of more than 4 vertices). If the
+ *  MCTOOLS_CACHE environment variable names a directory the clustering types are also kept there
+ *  between runs (one file per motif), so later runs skip building them. Compile mcregistry.c
+ *  alongside mccluster.c and mcmotif.c, e.g.
+ *
+ *     gcc -I INC_DIR -L LIB_DIR -O3 mcstats.c mcmotif.c mcgraph.c mccluster.c mcregistry.c
+ *         -ligraph -lstdc++ -o mcstats
+ *
+ *------------------------------------------------------------------------------------------------
+ *
+ *  Copyright (C) 2018 Thomas E. Gorochowski <tom@chofski.co.uk>
+ *
+ *  This software released under the Open Source Initiative (OSI) approved Non-Profit Open
+ *  Software License ("Non-Profit OSL") 3.0. This software is distributed in the hope that
+ *  it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *===============================================================================================*/
+
+#ifndef MCREGISTRY_H
+#define MCREGISTRY_H
+
+#include <igraph.h>
+#include "mcmotif.h"
+#include "mccluster.h"
+
+/* Environment variable naming the directory that caches clustering types between runs */
+#define MC_REGISTRY_CACHE "MCTOOLS_CACHE"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Descriptor of a motif, owned by the registry. */
+typedef struct {
+	int size;                  /* Number of vertices */
+	int isoclass;              /* Isomorphism class of the motif (as igraph_isoclass_create), -1 if
+	                              it was given as a graph */
+	igraph_bool_t directed;    /* Directedness of the motif */
+	unsigned long long code;   /* Adjacency of the motif (bit i*MC_MAX_MOTIF + j for i -> j) */
+	mc_motif_t motif;          /* Edge list, automorphism group and search plan */
+	igraph_bool_t hasTypes;    /* Whether the clustering types have been found */
+	mc_cluster_types_t types;  /* Clustering types of the motif */
+} mc_descriptor_t;
+
+/* Descriptor of a motif with its edge list, automorphisms and search plan, built on first use.
+ * Returns NULL if the motif is not a valid isoclass. */
+mc_descriptor_t *mc_registry_motif (int size, int isoclass, igraph_bool_t directed);
+
+/* Descriptor of a motif given as a graph of up to MC_MAX_MOTIF vertices, built on first use
+ * (motifs with the same vertex numbering and edges share a descriptor). Returns NULL if the graph
+ * is not a valid motif. */
+mc_descriptor_t *mc_registry_motif_graph (const igraph_t *motif);
+
+/* Adjacency code of a motif as held in its descriptor (bit i*MC_MAX_MOTIF + j for i -> j), which
+ * with the size and directedness identifies the motif. */
+unsigned long long mc_registry_code (const mc_motif_t *m);
+
+/* Clustering types of a motif, read from the cache or built (and cached) on first use. Returns
+ * NULL on failure. */
+mc_cluster_types_t *mc_registry_cluster_types (mc_descriptor_t *d);
+
+/* Free every descriptor held. */
+void mc_registry_clear (void);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+#endif
@@ -8,7 +8,8 @@
  *
  *  To compile use the following command:
  *
- *     gcc -I INC_DIR -L LIB_DIR -O3 mcstats.c -ligraph -lstdc++ -o mcstats
+ *     gcc -I INC_DIR -L LIB_DIR -O3 -fopenmp mcstats.c mcmotif.c mcgraph.c mccluster.c mcregistry.c
+ *         mcmetrics.c -ligraph -lstdc++ -o mcstats
  *
  *  where INC_DIR is the include directory and LIB_DIR is the library directory. The igraph
  *  library is required to compile this program and can be found at http://igraph.sourceforge.net/
@@ -17,12 +18,30 @@
  *
  *  Usage:
  *
- *     mcstats GRAPH_IN SIZE MOTIF_ID [OUT_PREFIX]
+ *     mcstats GRAPH_IN SIZE MOTIF_ID [OUT_PREFIX] [--undirected] [--threads N] [--pairs FILE]
+ *             [--pairs-binary FILE] [--metrics FILE]
  *
- *     GRAPH_IN   - GML format file of input graph
+ *     GRAPH_IN   - Input graph (GML, binary or edge list format, see mcgraph.h)
  *     SIZE       - Size of the motifs to consider
- *     MOTIF_ID   - The isomorphic class of the motif
- *     OUT_PREFIX - Prefix to output all clustering type and node map files (Optional)
+ *     MOTIF_ID   - The isomorphic class of the motif, or a file holding the motif graph (in any
+ *                  of the graph formats, needed for motifs of more than 4 nodes). Motifs of up to
+ *                  8 nodes are supported, their types being numbered as for the motif's vertex
+ *                  order.
+ *     OUT_PREFIX - Prefix to output all clustering type and node map files (Optional). The node
+ *                  maps give the original node IDs (the id attribute of GML nodes).
+ *     --undirected - Read an edge list as an undirected graph (default directed)
+ *     --threads N  - Number of threads classifying the pairs of motifs (default 1). Requires
+ *                    compiling with -fopenmp, the output is the same whatever the number.
+ *     --pairs FILE - Stream every pair of motifs sharing a vertex to FILE as CSV lines (after a
+ *                    header) of the two motifs and their clustering type (1 for Type1 and so
+ *                    on, 0 when the pair matches no type). The motifs themselves (node IDs in
+ *                    motif order) are listed one per line in FILE.motifs, the first being 0.
+ *     --pairs-binary FILE - As --pairs but each pair is a record of three native 64-bit
+ *                    integers (motif, motif, type).
+ *     --metrics FILE - Write a JSON report of the run to FILE (see mcmetrics.h): the wall and CPU
+ *                    time of loading, finding the clustering types, the motifs and classifying
+ *                    their pairs and the output, peak memory and counters of the mappings,
+ *                    instances and overlapping pairs found.
  *
  *------------------------------------------------------------------------------------------------
  *
@@ -39,77 +58,219 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include "mcmotif.h"
+#include "mcgraph.h"
+#include "mccluster.h"
+#include "mcregistry.h"
+#include "mcmetrics.h"
 
 #define TRUE -1
 #define FALSE 0
 
+/* Chunks of motif mappings per thread when classifying pairs, several so that threads finishing
+   early can take on the remaining work */
+#define CHUNKS_PER_THREAD 16
+
+/* Bitsets of the nodes of each clustering type (bit type*nodes + node) */
+#define BITSET_WORDS(n) (((n) >> 6) + 1)
+#define BITSET_TEST(b, k) (((b)[(k) >> 6] >> ((k) & 63)) & 1ULL)
+#define BITSET_SET(b, k) ((b)[(k) >> 6] |= 1ULL << ((k) & 63))
+#define BITSET_CLEAR(b, k) ((b)[(k) >> 6] &= ~(1ULL << ((k) & 63)))
+
 /* ---------------------------------------------------------------------------------------------- */
 
+/* Options of a run */
+typedef struct {
+	char *prefix;               /* Prefix of the clustering type and node map files, or NULL */
+	int threads;                /* Number of threads classifying the pairs of motifs */
+	const char *pairsFile;      /* File to stream the overlapping pairs to, or NULL */
+	igraph_bool_t pairsBinary;  /* Write the pairs as binary records rather than CSV */
+} stats_options_t;
+
 /* Function prototypes */
-int motif_clustering_stats (igraph_t *G, igraph_t *M, char *prefix);
-int clean_subgraph(igraph_t *res, igraph_t *G, igraph_t *M, igraph_vector_t *m1Nodes, igraph_vector_t *m2Nodes);
-int add_cluster_type (igraph_vector_ptr_t *cTypes, igraph_t *M, igraph_vector_t *m1, igraph_vector_t *m2);
-int merge_motifs (igraph_t *res, igraph_t *M, igraph_vector_t *m1, igraph_vector_t *m2);
+int motif_clustering_stats (mc_graph_t *gView, mc_descriptor_t *desc, const long long *ids,
+									 const stats_options_t *opts);
+igraph_bool_t add_motif_map (const int *map, void *arg);
 void print_usage (void);
 
+/* Collects the unique motif mappings as they are found by the enumeration */
+typedef struct {
+	mc_graph_t *view;            /* Graph being searched */
+	mc_motif_t *motif;           /* Motif being searched for */
+	igraph_integer_t mapsCount;  /* Number of mappings visited */
+	long int rejected;           /* Number of mappings that are not proper motifs */
+	mc_overlap_t *index;         /* Unique proper motif mappings (rows of motif size node IDs) */
+	mc_vertex_sets_t sets;       /* Vertex sets of the mappings in index */
+	igraph_bool_t failed;        /* Ran out of memory keeping the mappings */
+} map_visit_t;
+
+/* Results of classifying the pairs (i, j), i < j, of a contiguous range of motif mappings i */
+typedef struct {
+	long int first;            /* First mapping of the range */
+	long int last;             /* One past the last mapping of the range */
+	long int *counts;          /* Number of pairs of each clustering type */
+	long int overlapping;      /* Number of pairs sharing a vertex */
+	long int *members;         /* Nodes of each type (type*nodes + node) in the order found */
+	long int membersCount;     /* Number of members */
+	long int membersCapacity;  /* Room allocated for members */
+	long int *pairs;           /* Pairs (i, j, type) sharing a vertex, when they are streamed */
+	long int pairsCount;       /* Number of pairs held */
+	long int pairsCapacity;    /* Room allocated for pairs */
+} pair_chunk_t;
+
+int classify_pairs (pair_chunk_t *chunk, const mc_overlap_t *index, const mc_graph_t *view,
+						  const mc_motif_t *motif, const mc_cluster_types_t *cTypes, long int *partners,
+						  unsigned char *marks, unsigned long long *seen, igraph_bool_t keepPairs);
+int add_member (pair_chunk_t *chunk, unsigned long long *seen, long int key);
+int add_pair (pair_chunk_t *chunk, long int i, long int j, long int type);
+int write_pairs (FILE *out, igraph_bool_t binary, pair_chunk_t *chunk);
+int write_motifs (const char *filename, const mc_overlap_t *index, const long long *ids);
+
 /* ---------------------------------------------------------------------------------------------- */
 
 /* Main function */
 int main (int argc, const char * argv[])
 {
-	FILE *gFile;
-	igraph_t G, M;
+	igraph_t M;
+	mc_graph_file_t G;
+	mc_descriptor_t *desc;
+	igraph_bool_t directed;
+	const char *args[4];
+	char *end;
+	long int isoclass;
+	int a, positional, suc;
+	stats_options_t opts;
+	const char *metrics;
 	
 	/* Check that there are enough arguments */	
 	if (argc == 2 && strcmp(argv[1], "-h") == 0) {
 		print_usage();
 		return 0;
 	}
-	if (argc < 4 || argc > 5) {
+	
+	/* Separate the options from the positional arguments */
+	directed = 1;
+	opts.prefix = NULL;
+	opts.threads = 1;
+	opts.pairsFile = NULL;
+	opts.pairsBinary = 0;
+	metrics = NULL;
+	positional = 0;
+	for (a=1; a<argc; a++) {
+		if (strcmp(argv[a], "--undirected") == 0) {
+			directed = 0;
+		}
+		else if (strcmp(argv[a], "--threads") == 0 && a+1 < argc) {
+			opts.threads = atoi(argv[++a]);
+			if (opts.threads < 1) {
+				printf("Invalid number of threads.\n");
+				return 1;
+			}
+		}
+		else if ((strcmp(argv[a], "--pairs") == 0 || strcmp(argv[a], "--pairs-binary") == 0) &&
+					a+1 < argc) {
+			opts.pairsBinary = (strcmp(argv[a], "--pairs-binary") == 0);
+			opts.pairsFile = argv[++a];
+		}
+		else if (strcmp(argv[a], "--metrics") == 0 && a+1 < argc) {
+			metrics = argv[++a];
+		}
+		else if (positional < 4) {
+			args[positional++] = argv[a];
+		}
+		else {
+			positional++;
+		}
+	}
+	if (positional < 3 || positional > 4) {
 		printf("Invalid number of arguments.\n");
 		return 1;
 	}
 	
-	/* Load the user specified topology (GML Format) */
-	gFile = fopen(argv[1], "r");
-	igraph_read_graph_gml(&G, gFile);
-	fclose(gFile);
+#ifndef _OPENMP
+	if (opts.threads > 1) {
+		printf("Warning: compiled without OpenMP, pairs are classified on a single thread.\n");
+		fflush(stdout);
+	}
+#endif
 	
-	/* Generate a graph of the motif we are interested in - use isomorphic class ID */
-	igraph_isoclass_create(&M, atoi(argv[2]), atoi(argv[3]), igraph_is_directed(&G));
+	/* Load the user specified topology (any format, see mcgraph.h) */
+	if (metrics != NULL) {
+		mc_metrics_enable();
+	}
+	mc_metrics_begin(MC_PHASE_LOAD);
+	if (mc_graph_file_open(&G, args[0], directed) != 0) {
+		printf("Could not read graph from %s.\n", args[0]);
+		return 1;
+	}
 	
-	if (argc == 5) {
-		/* We need to output the clustering types in graphs */
-		motif_clustering_stats(&G, &M, (char *)argv[4]);
+	/* Descriptor of the motif we are interested in - use isomorphic class ID, or the motif graph
+	   from a file for larger motifs */
+	isoclass = strtol(args[2], &end, 10);
+	if (end != args[2] && *end == '\0') {
+		desc = mc_registry_motif(atoi(args[1]), (int)isoclass, G.view.directed);
+	}
+	else if (mc_graph_read(&M, args[2], directed) == 0) {
+		desc = NULL;
+		if (igraph_is_directed(&M) == G.view.directed &&
+			 (long int)igraph_vcount(&M) == atol(args[1])) {
+			desc = mc_registry_motif_graph(&M);
+		}
+		igraph_destroy(&M);
 	}
 	else {
-		/* No graph outputs */
-		motif_clustering_stats(&G, &M, NULL);
+		desc = NULL;
 	}
-		
+	if (desc == NULL) {
+		printf("Error: invalid motif (motifs of 3 and 4 nodes are given by their ID, larger ones by a\n"
+				 "file holding a motif of SIZE nodes with the same directedness as the graph)\n");
+		mc_graph_file_close(&G);
+		return 1;
+	}
+	mc_metrics_end(MC_PHASE_LOAD);
+	
+	if (positional == 4) {
+		/* We need to output the clustering types in graphs */
+		opts.prefix = (char *)args[3];
+	}
+	suc = motif_clustering_stats(&G.view, desc, G.ids, &opts);
+	if (metrics != NULL && mc_metrics_write(metrics, "mcstats", argc, argv) != 0) {
+		printf("Error: could not write the metrics to %s\n", metrics);
+	}
+	
 	/* Free used memory and return */
-	igraph_destroy(&G);
-	igraph_destroy(&M);
-	return 0;
+	mc_registry_clear();
+	mc_graph_file_close(&G);
+	return suc;
 }
 
 /* ---------------------------------------------------------------------------------------------- */
 
-/* Claculate motif clustering statistics */
-int motif_clustering_stats (igraph_t *G, igraph_t *M, char *prefix)
+/* Claculate motif clustering statistics (node IDs are reported from ids, or as the vertex
+   indices if it is NULL) */
+int motif_clustering_stats (mc_graph_t *gView, mc_descriptor_t *desc, const long long *ids,
+									 const stats_options_t *opts)
 {
-	igraph_integer_t i, j, k, s, t, p, i2, j2, k2, overlap, mapsCount, actMapsCount, count, found, mSize;
-	int res;
-	igraph_vector_t m1, m2, *curMap, *curAllMap, cTypeCounts, *curi, *curj, m1Nodes, m2Nodes, *curM;
-	igraph_t subGraph;
-	igraph_vs_t vs;
-	igraph_bool_t iso;
+	igraph_integer_t i, j, k, actMapsCount, mSize;
+	long int c, t, v, key, weight, target, chunksCount, overlapping, typeNodes, failed;
+	long int *partners, *chunkCounts;
+	unsigned char *marks;
+	unsigned long long *seen;
+	char *prefix;
+	FILE *pairsOut;
+	mc_overlap_t index;
+	pair_chunk_t *chunks;
+	igraph_vector_t cTypeCounts, *curM;
+	igraph_t typeGraph;
+	mc_cluster_types_t *cTypes;
 	char buf[1000];
 	FILE *outFile;
-	igraph_vector_ptr_t cTypes, maps, actMaps, nMap;
-	igraph_vector_ptr_init(&maps, 0);
-	igraph_vector_ptr_init(&cTypes, 0);
-	mSize = igraph_vcount(M);
+	igraph_vector_ptr_t nMap;
+	mc_motif_t *motif;
+	map_visit_t visit;
+	prefix = opts->prefix;
+	motif = &desc->motif;
+	mSize = (igraph_integer_t)motif->size;
 	
 	/* ----------------------------------------------------- */
 	/* PART I: Generate all motif clustering types in a list */
@@ -120,108 +281,34 @@ int motif_clustering_stats (igraph_t *G, igraph_t *M, char *prefix)
 	fflush(stdout);
 #endif
 
-	/* Loop through different size overlaps when clustered */
-	for (overlap=1; overlap<igraph_vcount(M); overlap++) {
-
-		if (overlap == 1) {
-			/* Create new lists the required size to hold overlap mapping */
-			igraph_vector_init(&m1, overlap);
-			igraph_vector_init(&m2, overlap);
-			/* Go through all possible permutations */
-			for (i=0; i<igraph_vcount(M); i++) {
-				for (i2=0; i2<igraph_vcount(M); i2++) {
-					/* Create mapping and add if new */
-					VECTOR(m1)[0] = i;
-					VECTOR(m2)[0] = i2;
-					add_cluster_type(&cTypes, M, &m1, &m2);
-				}
-			}
-			/* Free the overlap lists */
-			igraph_vector_destroy(&m1);
-			igraph_vector_destroy(&m2);			
-		}
-		else if (overlap == 2) {
-			/* Create new lists the required size to hold overlap mapping */
-			igraph_vector_init(&m1, overlap);
-			igraph_vector_init(&m2, overlap);
-			/* Go through all possible permutations */
-			for (i=0; i<igraph_vcount(M); i++) {
-				for (j=0; j<igraph_vcount(M); j++) {
-					if (i!=j) {
-						/* ------------------- */
-						for (i2=0; i2<igraph_vcount(M); i2++) {
-							for (j2=0; j2<igraph_vcount(M); j2++) {
-								if (i2!=j2) {
-									/* Create mapping and add if new */
-									VECTOR(m1)[0] = i;
-									VECTOR(m2)[0] = i2;
-									VECTOR(m1)[1] = j;
-									VECTOR(m2)[1] = j2;
-									add_cluster_type(&cTypes, M, &m1, &m2);
-								}
-							}
-						}
-						/* ------------------- */
-					}
-				}
-			}
-			/* Free the overlap lists */
-			igraph_vector_destroy(&m1);
-			igraph_vector_destroy(&m2);
-		}
-		else if (overlap == 3) {
-			/* Create new lists the required size to hold overlap mapping */
-			igraph_vector_init(&m1, overlap);
-			igraph_vector_init(&m2, overlap);
-			/* Go through all possible permutations */
-			for (i=0; i<igraph_vcount(M); i++) {
-				for (j=0; j<igraph_vcount(M); j++) {
-					for (k=0; k<igraph_vcount(M); k++) {
-						if (i!=j && i!=k && j!=k) {
-							/* ------------------- */
-							for (i2=0; i2<igraph_vcount(M); i2++) {
-								for (j2=0; j2<igraph_vcount(M); j2++) {
-									for (k2=0; k2<igraph_vcount(M); k2++) {
-										if (i2!=j2 && i2!=k2 && j2!=k2) {
-											/* Create mapping and add if new */
-											VECTOR(m1)[0] = i;
-											VECTOR(m2)[0] = i2;
-											VECTOR(m1)[1] = j;
-											VECTOR(m2)[1] = j2;
-											VECTOR(m1)[2] = k;
-											VECTOR(m2)[2] = k2;
-											add_cluster_type(&cTypes, M, &m1, &m2);
-										}
-									}
-								}
-							}
-							/* ------------------- */
-						}
-					}
-				}
-			}
-			/* Free the overlap lists */
-			igraph_vector_destroy(&m1);
-			igraph_vector_destroy(&m2);		
-		}
-		else {
-			printf("Error: there is currently only support for 3 and 4 node motifs\n");
-			return 1;
-		}			
+	/* Every way of overlapping two copies of the motif (up to the symmetries of the motif) is
+	   merged as a small adjacency matrix and kept if it is a new type (see mccluster.h), the
+	   types are taken from the registry so they are only generated once (and then cached between
+	   runs if enabled, see mcregistry.h) */
+	mc_metrics_begin(MC_PHASE_TYPES);
+	cTypes = mc_registry_cluster_types(desc);
+	mc_metrics_end(MC_PHASE_TYPES);
+	if (cTypes == NULL) {
+		printf("Error: could not generate the clustering types\n");
+		return 1;
 	}
 	
 	/* Check to see if we need to output the clustering types in GML format */
 	if (prefix != NULL ) {
-		for (i=0; i<igraph_vector_ptr_size(&cTypes); i++) {
-			sprintf(buf, "%sType%li.gml", prefix, (long int)i+1);
+		mc_metrics_begin(MC_PHASE_OUTPUT);
+		for (t=0; t<cTypes->count; t++) {
+			sprintf(buf, "%sType%li.gml", prefix, t+1);
 			outFile = fopen(buf, "w");
-			igraph_write_graph_gml((igraph_t *)VECTOR(cTypes)[(long int)i], outFile, NULL, NULL);
+			mc_union_graph(&typeGraph, &cTypes->types[t], cTypes->directed);
+			igraph_write_graph_gml(&typeGraph, outFile, NULL, NULL);
+			igraph_destroy(&typeGraph);
 			fclose(outFile);
 		}
+		mc_metrics_end(MC_PHASE_OUTPUT);
 	}
 	
 #ifdef DEBUG
-	printf("Found %li types of motif clustering\n", (long int)igraph_vector_ptr_size(&cTypes));
+	printf("Found %li types of motif clustering\n", cTypes->count);
 #endif
 	
 	/* -------------------------------------------------------- */
@@ -233,425 +320,436 @@ int motif_clustering_stats (igraph_t *G, igraph_t *M, char *prefix)
 	fflush(stdout);
 #endif
 	
-	/* Find submorphisms between graph and motif */
-	igraph_get_subisomorphisms_vf2(G, M, NULL, NULL, NULL, NULL, &maps, NULL, NULL, NULL);
-	
-#ifdef DEBUG
-	printf("Cleaning up motif mappings.\n");
-	fflush(stdout);
-#endif
-	
-	/* Clean up maps list (only required for directed graphs) */
-	if (igraph_is_directed(G) != 0) {
-		for (i=0; i<igraph_vector_ptr_size(&maps); i++) {
-			curMap = (igraph_vector_t *)VECTOR(maps)[(long int)i];
-			/* Generate a vertex selector from our IDs vector */
-			igraph_vs_vector(&vs, curMap);
-			/* Extract the subgraph using this vertex selector */
-			igraph_induced_subgraph(G, &subGraph, vs, IGRAPH_SUBGRAPH_CREATE_FROM_SCRATCH);
-			/* Check to see if the motif is missing edges from original graph => not proper motif */
-			if (igraph_ecount(&subGraph) != igraph_vcount(M)) {
-				/* Remove mapping set first value to -1*/
-				VECTOR(*curMap)[0] = -1;
-			}
-			/* Free used memory */
-			igraph_vs_destroy(&vs);
-			igraph_destroy(&subGraph);
-		}
+	/* Find one mapping between graph and motif for each motif instance, each is cleaned up and
+	   kept only if it is a new proper motif as soon as it is found. The mappings go straight into
+	   the rows of the index (contiguous node IDs, motif size per mapping) */
+	mc_metrics_begin(MC_PHASE_MOTIFS);
+	mc_overlap_init(&index, (long int)mSize, gView->nodes);
+	visit.view = gView;
+	visit.motif = motif;
+	visit.mapsCount = 0;
+	visit.rejected = 0;
+	visit.index = &index;
+	visit.failed = 0;
+	mc_vertex_sets_init(&visit.sets, (int)mSize, gView->nodes);
+	mc_motif_enumerate(gView, motif, 1, add_motif_map, &visit);
+	mc_vertex_sets_destroy(&visit.sets);
+	if (visit.failed != 0) {
+		printf("Error: not enough memory to keep the motif mappings\n");
+		mc_overlap_destroy(&index);
+		return 1;
 	}
+	actMapsCount = (igraph_integer_t)index.count;
+	mc_metrics_add(MC_COUNT_MAPPINGS, (long long)visit.mapsCount);
+	mc_metrics_add(MC_COUNT_REJECTED, visit.rejected);
+	mc_metrics_add(MC_COUNT_INSTANCES, index.count);
+	mc_metrics_end(MC_PHASE_MOTIFS);
 	
-	/* Keep track of the unique motifs found so far */
-	mapsCount = igraph_vector_ptr_size(&maps);
-	actMapsCount = 0;
-	
-	/* Somewhere to hold the actual motifs, resize later once the actual number is known */
-	igraph_vector_ptr_init(&actMaps, mapsCount);
-	
-	/* Go through the whole list and add if not found already */
-	for (i=0; i<mapsCount; i++) {
-		curAllMap = (igraph_vector_t *)VECTOR(maps)[(long int)i];
-		if (VECTOR(*curAllMap)[0] != -1) {
-			
-			found = 0;
-			for (j=0; j<actMapsCount; j++) {
-				curMap = (igraph_vector_t *)VECTOR(actMaps)[(long int)j];
-				/* Loop through both vectors and see if matching elements are found */
-				count = 0;
-				for (s=0; s<igraph_vcount(M); s++) {
-					for (t=0; t<igraph_vcount(M); t++) {
-						if (VECTOR(*curAllMap)[(long int)s] == VECTOR(*curMap)[(long int)t]) {
-							count++;
-							break;
-						}
-					}
-				}
-				if (count == igraph_vcount(M)) {
-					/* Found the motif, break and do not add */
-					found = 1;
-					break;
-				}
-			}
-			if (found == 0) {
-				/* New motif so add */
-				VECTOR(actMaps)[(long int)actMapsCount] = curAllMap;
-				actMapsCount++;
-			}
-			
-		}
-	}
-
 #ifdef DEBUG
 	printf("Found %li actual motif mappings in graph.\n", (long int)actMapsCount);
 	fflush(stdout);
 #endif
 	
-	/* Resize to the actual count number */
-	igraph_vector_ptr_resize(&actMaps, actMapsCount);
-	
-	/* At this point, actMaps contains the clean list of motif mappings; we now look at all pairs
-	   compare to the clustering types we generated previously */
+	/* At this point, the index holds the clean list of motif mappings; we now look at all pairs
+	   compare to the clustering types we generated previously. Only pairs that share a vertex can
+	   be clustered, so these are found from the lists of the mappings of each vertex and all other
+	   pairs are counted as not clustered */
+	mc_metrics_begin(MC_PHASE_PAIRS);
+	if (mc_overlap_build(&index) != 0) {
+		printf("Error: not enough memory to index the motif mappings\n");
+		mc_overlap_destroy(&index);
+		return 1;
+	}
 
 #ifdef DEBUG
 	printf("Finding all pairs of motif and comparing to types.\n");
 	fflush(stdout);
 #endif
 	
-	if (prefix != NULL ) {
-		/* List to hold node IDs for each type of clustering */
-		igraph_vector_ptr_init(&nMap, igraph_vector_ptr_size(&cTypes));
-		for (i=0; i<igraph_vector_ptr_size(&cTypes); i++) {
-			VECTOR(nMap)[(long int)i] = (igraph_vector_t *)malloc(sizeof(igraph_vector_t));
-			igraph_vector_init(VECTOR(nMap)[(long int)i], 0);
+	/* Split the mappings into contiguous chunks of about the same work, estimated for a mapping
+	   by the number of mappings sharing each of its vertices (pairs are very unevenly spread as
+	   hubs take part in far more of them) */
+	weight = 0;
+	for (i=0; i<index.count*index.size; i++) {
+		v = index.verts[(long int)i];
+		weight += index.offsets[v+1] - index.offsets[v];
+	}
+	target = weight/((long int)CHUNKS_PER_THREAD*opts->threads) + 1;
+	chunks = (pair_chunk_t *)calloc(index.count + 1, sizeof(pair_chunk_t));
+	chunkCounts = (long int *)calloc((index.count + 1)*(cTypes->count + 1), sizeof(long int));
+	chunksCount = 0;
+	weight = 0;
+	for (c=0; c<index.count; c++) {
+		if (weight == 0) {
+			chunks[chunksCount].first = c;
+			chunks[chunksCount].counts = chunkCounts + chunksCount*(cTypes->count + 1);
+			chunksCount++;
+		}
+		for (k=0; k<mSize; k++) {
+			v = index.verts[c*index.size + (long int)k];
+			weight += index.offsets[v+1] - index.offsets[v];
+		}
+		chunks[chunksCount-1].last = c+1;
+		if (weight >= target) {
+			weight = 0;
 		}
 	}
 	
-	/* Create vector to hold the counts for each clustering type */
-	igraph_vector_init(&cTypeCounts, igraph_vector_ptr_size(&cTypes)+1);
-	igraph_vector_fill(&cTypeCounts, (igraph_integer_t)0);
+	/* Open the stream of pairs, the motifs they refer to are listed alongside */
+	pairsOut = NULL;
+	failed = 0;
+	if (opts->pairsFile != NULL) {
+		sprintf(buf, "%.990s.motifs", opts->pairsFile);
+		pairsOut = fopen(opts->pairsFile, (opts->pairsBinary != 0) ? "wb" : "w");
+		if (pairsOut == NULL || write_motifs(buf, &index, ids) != 0) {
+			printf("Error: could not write the pairs of motifs to %s\n", opts->pairsFile);
+			failed++;
+		}
+		else if (opts->pairsBinary == 0) {
+			fprintf(pairsOut, "Motif1,Motif2,Type\n");
+		}
+	}
 	
-	igraph_vector_init(&m1Nodes, mSize);
-	igraph_vector_init(&m2Nodes, mSize);
-	for (i=0; i<actMapsCount-1; i++) {
-		curi = (igraph_vector_t *)VECTOR(actMaps)[(long int)i];
-		for (j=i+(igraph_integer_t)1; j<actMapsCount; j++) {
-			curj = (igraph_vector_t *)VECTOR(actMaps)[(long int)j];
-			
-			/* Generate the subgraph of the motifs */
-			for (k=0; k<mSize; k++) {
-				VECTOR(m1Nodes)[(long int)k] = VECTOR(*curi)[(long int)k];
-				VECTOR(m2Nodes)[(long int)k] = VECTOR(*curj)[(long int)k];
+	/* Classify the pairs of each chunk, each thread with its own workspace and each chunk with
+	   its own results. Only plain memory is used inside (igraph is not thread safe). Streamed
+	   pairs are written a chunk at a time in order (as soon as the chunks before are written) */
+	typeNodes = (prefix != NULL) ? cTypes->count*gView->nodes : 0;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(opts->threads) default(none) private(c, partners, marks, seen) \
+	shared(chunks, chunksCount, index, gView, motif, cTypes, typeNodes, failed, pairsOut, opts)
+#endif
+	{
+		partners = (long int *)malloc(sizeof(long int)*(index.count + 1));
+		marks = (unsigned char *)calloc(index.count + 1, sizeof(unsigned char));
+		seen = (unsigned long long *)calloc(BITSET_WORDS(typeNodes), sizeof(unsigned long long));
+		
+		if (pairsOut == NULL) {
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1)
+#endif
+			for (c=0; c<chunksCount; c++) {
+				if (partners == NULL || marks == NULL || seen == NULL ||
+					 classify_pairs(&chunks[c], &index, gView, motif, cTypes, partners, marks,
+										 (typeNodes > 0) ? seen : NULL, 0) != 0) {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+					failed++;
+				}
 			}
-			res = clean_subgraph(&subGraph, G, M, &m1Nodes, &m2Nodes);
-
-			/* Check to see if any clustering has occured */
-			if (res != 1) {
-				/* Find clustering type and increment count */
-				for (k=0; k<igraph_vector_ptr_size(&cTypes); k++) {
-					igraph_isomorphic(&subGraph, (igraph_t *)VECTOR(cTypes)[(long int)k], &iso);
-					if ((long int)iso != (long int)0) {
-						/* Found the type, update the count and break */
-						VECTOR(cTypeCounts)[(long int)k] = (VECTOR(cTypeCounts)[(long int)k])+1;
-
-						/* If outputing node maps then check if already exists and output to file */
-						if (prefix != NULL ) {
-							/* Check to see if the vector already contains element and add for all */
-							for (p=0; p<mSize; p++) {
-								if (igraph_vector_contains((igraph_vector_t *)VECTOR(nMap)[(long int)k], 
-														(igraph_real_t)VECTOR(m1Nodes)[(long int)p]) == FALSE){
-									igraph_vector_push_back(VECTOR(nMap)[(long int)k], 
-																	(igraph_real_t)VECTOR(m1Nodes)[(long int)p]);
-								}
-								if (igraph_vector_contains((igraph_vector_t *)VECTOR(nMap)[(long int)k], 
-														(igraph_real_t)VECTOR(m2Nodes)[(long int)p]) == FALSE){
-									igraph_vector_push_back(VECTOR(nMap)[(long int)k], 
-																	(igraph_real_t)VECTOR(m2Nodes)[(long int)p]);
-
-								}
-							}
-						}
-						
-						/* Don't continue searching, break instead */
-						break;
+		}
+		else {
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1) ordered
+#endif
+			for (c=0; c<chunksCount; c++) {
+				if (partners == NULL || marks == NULL || seen == NULL ||
+					 classify_pairs(&chunks[c], &index, gView, motif, cTypes, partners, marks,
+										 (typeNodes > 0) ? seen : NULL, 1) != 0) {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+					failed++;
+				}
+#ifdef _OPENMP
+#pragma omp ordered
+#endif
+				{
+					if (write_pairs(pairsOut, opts->pairsBinary, &chunks[c]) != 0) {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+						failed++;
 					}
 				}
-				igraph_destroy(&subGraph);
 			}
-			else {
-				VECTOR(cTypeCounts)[igraph_vector_ptr_size(&cTypes)] = 
-				(VECTOR(cTypeCounts)[igraph_vector_ptr_size(&cTypes)])+1;
+		}
+		
+		free(partners);
+		free(marks);
+		free(seen);
+	}
+	if (pairsOut != NULL && fclose(pairsOut) != 0) {
+		failed++;
+	}
+	
+	/* Create vector to hold the counts for each clustering type */
+	igraph_vector_init(&cTypeCounts, cTypes->count+1);
+	igraph_vector_fill(&cTypeCounts, (igraph_integer_t)0);
+	
+	if (prefix != NULL ) {
+		/* List to hold node IDs for each type of clustering */
+		igraph_vector_ptr_init(&nMap, cTypes->count);
+		for (t=0; t<cTypes->count; t++) {
+			VECTOR(nMap)[t] = (igraph_vector_t *)malloc(sizeof(igraph_vector_t));
+			igraph_vector_init(VECTOR(nMap)[t], 0);
+		}
+	}
+	
+	/* Add up the chunks in order, so the counts and node maps are those of a serial run */
+	seen = (unsigned long long *)calloc(BITSET_WORDS(typeNodes), sizeof(unsigned long long));
+	overlapping = 0;
+	for (c=0; c<chunksCount; c++) {
+		overlapping += chunks[c].overlapping;
+		for (t=0; t<cTypes->count; t++) {
+			VECTOR(cTypeCounts)[t] = VECTOR(cTypeCounts)[t] + (igraph_real_t)chunks[c].counts[t];
+		}
+		for (k=0; k<chunks[c].membersCount; k++) {
+			key = chunks[c].members[(long int)k];
+			if (seen != NULL && BITSET_TEST(seen, key) == 0) {
+				BITSET_SET(seen, key);
+				igraph_vector_push_back(VECTOR(nMap)[key / gView->nodes],
+												(igraph_real_t)(key % gView->nodes));
 			}
 		}
+		free(chunks[c].members);
+	}
+	if (seen == NULL) {
+		failed++;
+	}
+	free(seen);
+	free(chunks);
+	free(chunkCounts);
+	mc_overlap_destroy(&index);
+	if (failed > 0) {
+		printf("Error: could not classify the pairs of motifs\n");
 	}
+	mc_metrics_add(MC_COUNT_OVERLAPPING, overlapping);
+	mc_metrics_end(MC_PHASE_PAIRS);
+	
+	/* Every other pair shares no vertex */
+	VECTOR(cTypeCounts)[cTypes->count] =
+		(igraph_real_t)((long int)actMapsCount*((long int)actMapsCount-1)/2 - overlapping);
 	
 	/* Check to see if we need to output the node maps */
+	mc_metrics_begin(MC_PHASE_OUTPUT);
 	if (prefix != NULL ) {
-		sprintf(buf, "%sNodeMaps.txt", prefix);
-		outFile = fopen(buf, "w");
-		for (i=0; i<igraph_vector_ptr_size(&cTypes); i++) {
-			curM = (igraph_vector_t *)VECTOR(nMap)[(long int)i];
-			for (j=0; j<igraph_vector_size(curM); j++) {
-				fprintf(outFile, "%li", (long int)VECTOR(*curM)[(long int)j]);
-				if (j < igraph_vector_size(curM)-1) fprintf(outFile, ",");
+		if (failed == 0) {
+			sprintf(buf, "%sNodeMaps.txt", prefix);
+			outFile = fopen(buf, "w");
+			for (t=0; t<cTypes->count; t++) {
+				curM = (igraph_vector_t *)VECTOR(nMap)[t];
+				for (j=0; j<igraph_vector_size(curM); j++) {
+					v = (long int)VECTOR(*curM)[(long int)j];
+					fprintf(outFile, "%lli", (ids != NULL) ? ids[v] : (long long)v);
+					if (j < igraph_vector_size(curM)-1) fprintf(outFile, ",");
+				}
+				fprintf(outFile, "\n");
 			}
-			fprintf(outFile, "\n");
+			fclose(outFile);
 		}
-		fclose(outFile);
+		
+		for (i=0; i<igraph_vector_ptr_size(&nMap); i++) {
+			curM = (igraph_vector_t *)VECTOR(nMap)[(long int)i];
+			igraph_vector_destroy(curM);
+			free(curM);
+		}
+		igraph_vector_ptr_destroy(&nMap);
 	}
 	
 	/* Print out the results */
-	for (i=0; i<igraph_vector_size(&cTypeCounts); i++) {
-		printf("%li", (long int)VECTOR(cTypeCounts)[(long int)i]);
-		if (i+1<igraph_vector_size(&cTypeCounts)) printf(",");
+	if (failed == 0) {
+		for (i=0; i<igraph_vector_size(&cTypeCounts); i++) {
+			printf("%li", (long int)VECTOR(cTypeCounts)[(long int)i]);
+			if (i+1<igraph_vector_size(&cTypeCounts)) printf(",");
+		}
+		printf("\n");
 	}
-	printf("\n");
+	mc_metrics_end(MC_PHASE_OUTPUT);
 	
-	return 0;
+	/* Free used memory */
+	igraph_vector_destroy(&cTypeCounts);
+	
+	return (failed > 0) ? 1 : 0;
 }
 
 /* ---------------------------------------------------------------------------------------------- */
 
-/* Generate a clean subgraph of the motif mappings - returns 1 if no clustering */
-int clean_subgraph(igraph_t *res, igraph_t *G, igraph_t *M, igraph_vector_t *m1Nodes, igraph_vector_t *m2Nodes)
+/* Visitor for the motif enumeration - keeps the mapping if it is a new proper motif */
+igraph_bool_t add_motif_map (const int *map, void *arg)
 {
-	igraph_vector_t map;
-	long int pos1, pos2;
-	igraph_es_t es;
-	igraph_eit_t eit;
-	igraph_bool_t s1, s2;
-	igraph_integer_t mSize, i, j, mapSize, eid, found;
-	mSize = igraph_vector_size(m1Nodes);
-	
-	/* Check if any overlap - most will not so worth doing this separately */
-	found = 0;
-	for (i=0; i<mSize; i++) {
-		for (j=0; j<mSize; j++) {
-			if ((long int)VECTOR(*m2Nodes)[(long int)i] ==
-				 (long int)VECTOR(*m1Nodes)[(long int)j]) {
-				found++;
-				break;
-			}
-		}
-		if (found == 1) break;
+	map_visit_t *visit = (map_visit_t *)arg;
+	int res;
+	
+	visit->mapsCount++;
+	
+	/* Clean up mapping (only required for directed graphs) */
+	if (visit->view->directed != 0 && mc_motif_induced(visit->view, visit->motif, map) == 0) {
+		/* Not a proper motif */
+		visit->rejected++;
+		return 1;
 	}
-	if (found == 0) return 1;
 	
-	/* Make the full mapping vector */
-	igraph_vector_init(&map, mSize*2);
-	igraph_vector_fill(&map, -1.0);
-	for (i=0; i<mSize; i++) {
-		VECTOR(map)[(long int)i] = (igraph_real_t)VECTOR(*m1Nodes)[(long int)i];
+	/* Check the mapping against those already found (by its vertex set) */
+	res = mc_vertex_sets_add(&visit->sets, map);
+	if (res == 0) {
+		/* Found the motif, do not add */
+		return 1;
 	}
-	mapSize = mSize;
 	
-	/* Copy the motifs */
-	igraph_copy(res, M);
-
-	for (i=0; i<mSize; i++) {
-		found = 0;
-		for (j=0; j<mSize; j++) {
-			if ((long int)VECTOR(*m2Nodes)[(long int)i] ==
-				 (long int)VECTOR(*m1Nodes)[(long int)j]) {
-				found = 1;
-				break;
-			}
-		}
-		
-		if (found == 0) {
-			/* Add the node to graph and update mapping list */
-			VECTOR(map)[(long int)mapSize] = (igraph_real_t)VECTOR(*m2Nodes)[(long int)i];
-			igraph_add_vertices(res, 1, 0);
-			mapSize++;
-		}
+	/* New motif so add */
+	if (res < 0 || mc_overlap_add(visit->index, map) != 0) {
+		/* Out of memory, stop the enumeration */
+		visit->failed = 1;
+		return 0;
 	}
-	/* Update the size of the vector */
-	igraph_vector_resize(&map, mapSize);
-
-	/* Add the rest of the edges from the motif */
-	for (i=mSize; i<mapSize; i++) {
+	
+	return 1;
+}
 
-		/* Get all edge (IN and OUT) from the node */
-		igraph_es_incident(&es, (igraph_integer_t)VECTOR(map)[(long int)i], IGRAPH_ALL);
+/* ---------------------------------------------------------------------------------------------- */
 
-		/* For each edge check to see if other end is in mapping list */
-		igraph_eit_create(G, es, &eit);
-		IGRAPH_EIT_RESET(eit);
-		do {
+/* Classify the pairs of a chunk of motif mappings, recording the nodes of each type if seen (a
+   zeroed bitset over the types and nodes, zeroed again on return) is given and each pair if
+   keepPairs is set. Returns 1 if out of memory */
+int classify_pairs (pair_chunk_t *chunk, const mc_overlap_t *index, const mc_graph_t *view,
+						  const mc_motif_t *motif, const mc_cluster_types_t *cTypes, long int *partners,
+						  unsigned char *marks, unsigned long long *seen, igraph_bool_t keepPairs)
+{
+	long int i, q, p, t, partnersCount;
+	const int *m1Nodes, *m2Nodes;
+	mc_union_t subUnion;
+	int res;
+	
+	res = 0;
+	for (i=chunk->first; i<chunk->last && res == 0; i++) {
+		m1Nodes = index->verts + i*index->size;
+		partnersCount = mc_overlap_partners(index, i, partners, marks);
+		chunk->overlapping += partnersCount;
+		for (q=0; q<partnersCount && res == 0; q++) {
+			m2Nodes = index->verts + partners[q]*index->size;
 			
-			/* Find the mapping */
-			eid = IGRAPH_EIT_GET(eit);		
-			if(igraph_vector_contains(m2Nodes, (igraph_real_t)IGRAPH_FROM(G, eid)) != 0
-				&& igraph_vector_contains(m2Nodes, (igraph_real_t)IGRAPH_TO(G, eid)) != 0) {
+			/* Generate the union of the motifs (no memory is allocated) */
+			mc_cluster_union(&subUnion, view, motif, m1Nodes, m2Nodes);
 			
-				s1 = igraph_vector_search(&map, 0, (igraph_real_t)IGRAPH_FROM(G, eid), &pos1);
-				s2 = igraph_vector_search(&map, 0, (igraph_real_t)IGRAPH_TO(G, eid), &pos2);
-
-				/* If so then use mapping to add edge */
-				if (s1 != 0 && s2 != 0) {
-					igraph_add_edge(res, (igraph_integer_t)pos1, (igraph_integer_t)pos2);
-				}
+			/* Find clustering type from the canonical code of the union and increment count */
+			t = mc_cluster_types_find(cTypes, &subUnion);
+			if (keepPairs != 0) {
+				res = add_pair(chunk, i, partners[q], t+1);
 			}
+			if (t < 0 || res != 0) {
+				continue;
+			}
+			chunk->counts[t]++;
 			
-			IGRAPH_EIT_NEXT(eit);
-		} while (!IGRAPH_EIT_END(eit));
-		igraph_eit_destroy(&eit);
-		igraph_es_destroy(&es);
+			/* Keep the nodes of both motifs in the order they appear */
+			if (seen != NULL) {
+				for (p=0; p<index->size && res == 0; p++) {
+					res = add_member(chunk, seen, t*view->nodes + m1Nodes[p]);
+					if (res == 0) {
+						res = add_member(chunk, seen, t*view->nodes + m2Nodes[p]);
+					}
+				}
+			}
+		}
 	}
-
-	/* Remove any duplicate edges */
-	igraph_simplify(res, -1, -1, 0);
-
-	/* Free used memory */
-	igraph_vector_destroy(&map);
 	
-	return 0;
+	/* Reset the flags for the next chunk */
+	if (seen != NULL) {
+		for (p=0; p<chunk->membersCount; p++) {
+			BITSET_CLEAR(seen, chunk->members[p]);
+		}
+	}
+	return res;
 }
 
 /* ---------------------------------------------------------------------------------------------- */
 
-/* Given a new cluster mapping, checks if exists and adds to types pointer list */
-int add_cluster_type (igraph_vector_ptr_t *cTypes, igraph_t *M, igraph_vector_t *m1, igraph_vector_t *m2)
+/* Add a node of a clustering type to a chunk unless it is already there */
+int add_member (pair_chunk_t *chunk, unsigned long long *seen, long int key)
 {
-	igraph_t *G, *curG, tempG;
-	igraph_integer_t i, morphs, found;
-	igraph_vs_t vs;
-	igraph_vector_t seq;
+	long int *members;
 	
-#ifdef DEBUG
-	printf("Entering add_cluster_type\n");
-	fflush(stdout);
-#endif DEBUG
-	
-	G = (igraph_t *)malloc(sizeof(igraph_t));
-	merge_motifs(G, M, m1, m2);
-	
-	/* Check that the clustering doesn't upset the motif type (double edges) */
-	igraph_vector_init(&seq, igraph_vcount(M));
-	for (i=0; i<igraph_vcount(M); i++) {
-		VECTOR(seq)[(long int)i] = i;
-	}
-	igraph_vs_vector(&vs, &seq);
-	igraph_induced_subgraph(G, &tempG, vs, IGRAPH_SUBGRAPH_CREATE_FROM_SCRATCH);	
-	if ((long int)igraph_ecount(&tempG) != (long int)igraph_ecount(M)) {
-		igraph_destroy(&tempG);
-		igraph_vs_destroy(&vs);
-		igraph_vector_destroy(&seq);
+	if (BITSET_TEST(seen, key) != 0) {
 		return 0;
 	}
-	igraph_destroy(&tempG);
-	igraph_vs_destroy(&vs);
-	
-	/* Do it for the other motifs mapping as well */
-	for (i=0; i<igraph_vector_size(m1); i++) {
-		VECTOR(seq)[(long int)i] = VECTOR(*m1)[(long int)i];
-	}
-	for (i=0; i<igraph_vcount(M)-igraph_vector_size(m1); i++) {
-		VECTOR(seq)[(long int)(igraph_vector_size(m1) + i)] = igraph_vcount(M) + i;
-	}
-	igraph_vs_vector(&vs, &seq);
-	igraph_induced_subgraph(G, &tempG, vs, IGRAPH_SUBGRAPH_CREATE_FROM_SCRATCH);	
-	if ((long int)igraph_ecount(&tempG) != (long int)igraph_ecount(M)) {
-		igraph_destroy(&tempG);
-		igraph_vs_destroy(&vs);
-		igraph_vector_destroy(&seq);
-		return 0;
-	}
-	igraph_destroy(&tempG);
-	igraph_vs_destroy(&vs);
-	igraph_vector_destroy(&seq);
-	
-	/* See if the motif clustering type is already found */
-	found = 0;
-	for (i=0; i<igraph_vector_ptr_size(cTypes); i++) {
-		curG = (igraph_t *)VECTOR(*cTypes)[(long int)i];
-		/* Check to see if the clustering type is the same */
-		if (igraph_vcount(G) == igraph_vcount(curG) && igraph_ecount(G) == igraph_ecount(curG)) {
-			igraph_count_subisomorphisms_vf2(G, curG, NULL, NULL, NULL, NULL, &morphs, NULL, NULL, NULL);
-			if (morphs > 0) {
-				/* Must already exist */
-				found = 1;
-				break;
-			}
-		}		
-	}
-	
-	/* Didn't find it so append to list */
-	if (found == 0) {
-		igraph_vector_ptr_push_back(cTypes, (void *)G);
+	if (chunk->membersCount == chunk->membersCapacity) {
+		members = (long int *)realloc(chunk->members,
+												sizeof(long int)*(2*chunk->membersCapacity + 64));
+		if (members == NULL) {
+			return 1;
+		}
+		chunk->members = members;
+		chunk->membersCapacity = 2*chunk->membersCapacity + 64;
 	}
+	BITSET_SET(seen, key);
+	chunk->members[chunk->membersCount++] = key;
+	return 0;
+}
 
-#ifdef DEBUG
-	printf("Leaving add_cluster_type\n");
-	fflush(stdout);
-#endif DEBUG
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Add a pair of motifs and its clustering type (from 1, 0 if none) to those to be streamed */
+int add_pair (pair_chunk_t *chunk, long int i, long int j, long int type)
+{
+	long int *pairs;
 	
+	if (chunk->pairsCount == chunk->pairsCapacity) {
+		pairs = (long int *)realloc(chunk->pairs,
+											 3*sizeof(long int)*(2*chunk->pairsCapacity + 64));
+		if (pairs == NULL) {
+			return 1;
+		}
+		chunk->pairs = pairs;
+		chunk->pairsCapacity = 2*chunk->pairsCapacity + 64;
+	}
+	chunk->pairs[3*chunk->pairsCount] = i;
+	chunk->pairs[3*chunk->pairsCount+1] = j;
+	chunk->pairs[3*chunk->pairsCount+2] = type;
+	chunk->pairsCount++;
 	return 0;
 }
 
 /* ---------------------------------------------------------------------------------------------- */
 
-/* Merge the same motif twice using a set of vertex overlaps */
-int merge_motifs (igraph_t *res, igraph_t *M, igraph_vector_t *m1, igraph_vector_t *m2)
+/* Write the pairs of a chunk to the stream (CSV lines or binary records) and free them */
+int write_pairs (FILE *out, igraph_bool_t binary, pair_chunk_t *chunk)
 {
-	igraph_vector_t map, newEdges;
-	igraph_integer_t i, j, remaining;
-	igraph_eit_t eit;
-
-#ifdef DEBUG
-	printf("Entering merge_motifs\n");
-	fflush(stdout);
-#endif DEBUG
-	
-	/* Create the merged graph with correct number of nodes */
-	igraph_copy(res, M);
-	remaining = igraph_vcount(M) - igraph_vector_size(m1);
-	igraph_add_vertices(res, remaining, 0);
-	
-	/* Create the mapping to the new graph, so that edges can be merged correctly */
-	igraph_vector_init(&map, igraph_vcount(M));
-	igraph_vector_fill(&map, -1.0);
+	long long record[3];
+	long int p;
+	int res;
 	
-	/* Set the known mappings from the overlap */
-	for (i=0; i<igraph_vector_size(m1); i++) {
-		VECTOR(map)[(long int)VECTOR(*m2)[(long int)i]] = VECTOR(*m1)[(long int)i];
+	res = 0;
+	for (p=0; p<chunk->pairsCount && res == 0; p++) {
+		if (binary != 0) {
+			record[0] = (long long)chunk->pairs[3*p];
+			record[1] = (long long)chunk->pairs[3*p+1];
+			record[2] = (long long)chunk->pairs[3*p+2];
+			res = (fwrite(record, sizeof(long long), 3, out) != 3);
+		}
+		else {
+			res = (fprintf(out, "%li,%li,%li\n", chunk->pairs[3*p], chunk->pairs[3*p+1],
+								chunk->pairs[3*p+2]) < 0);
+		}
 	}
+	free(chunk->pairs);
+	chunk->pairs = NULL;
+	chunk->pairsCount = 0;
+	chunk->pairsCapacity = 0;
+	return res;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* List the motif mappings (original node IDs in motif order), one per line */
+int write_motifs (const char *filename, const mc_overlap_t *index, const long long *ids)
+{
+	FILE *outFile;
+	long int i, k, v;
 	
-	/* Update the remaining mapping entries with new node IDs */
-	j = igraph_vcount(M);
-	for (i=0; i<igraph_vector_size(&map); i++) {
-		/* See if item needs updating */
-		if ((long int)VECTOR(map)[(long int)i] == (long int)-1) {
-			VECTOR(map)[(long int)i] = j;
-			j++;
+	outFile = fopen(filename, "w");
+	if (outFile == NULL) {
+		return 1;
+	}
+	for (i=0; i<index->count; i++) {
+		for (k=0; k<index->size; k++) {
+			v = (long int)index->verts[i*index->size + k];
+			fprintf(outFile, "%lli", (ids != NULL) ? ids[v] : (long long)v);
+			if (k < index->size-1) fprintf(outFile, ",");
 		}
+		fprintf(outFile, "\n");
 	}
-	
-	/* Use the mappings list we have to add the edges */
-	igraph_eit_create(M, igraph_ess_all(IGRAPH_EDGEORDER_ID), &eit);
-	igraph_vector_init(&newEdges, igraph_ecount(M)*2);
-	i = 0;
-	IGRAPH_EIT_RESET(eit);
-	do {
-		VECTOR(newEdges)[(long int)i] = VECTOR(map)[(long int)IGRAPH_FROM(M, IGRAPH_EIT_GET(eit))];
-		VECTOR(newEdges)[(long int)i+1] = VECTOR(map)[(long int)IGRAPH_TO(M, IGRAPH_EIT_GET(eit))];
-		i += 2;
-		IGRAPH_EIT_NEXT(eit);
-	} while (!IGRAPH_EIT_END(eit));
-	igraph_add_edges(res, &newEdges, 0);
-	
-	/* Remove duplicate edges (this interferes with isomorphic tests later) */
-	igraph_simplify(res, TRUE, FALSE, 0);
-	
-	/* Free used memory */
-	igraph_vector_destroy(&map);
-	igraph_vector_destroy(&newEdges);
-	igraph_eit_destroy(&eit);
-	
-#ifdef DEBUG
-	printf("Leaving merge_motifs\n");
-	fflush(stdout);
-#endif DEBUG
-	
-	return 0;
+	return (fclose(outFile) != 0);
 }
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -659,11 +757,17 @@ int merge_motifs (igraph_t *res, igraph_t *M, igraph_vector_t *m1, igraph_vector
 /* Print usage information */
 void print_usage (void)
 {
-	printf("mcstats GRAPH_IN SIZE MOTIF_ID [OUT_PREFIX]\n");
-	printf("  GRAPH_IN   - GML format file of input graph\n");
+	printf("mcstats GRAPH_IN SIZE MOTIF_ID [OUT_PREFIX] [--undirected] [--threads N] [--pairs FILE]\n");
+	printf("        [--pairs-binary FILE] [--metrics FILE]\n");
+	printf("  GRAPH_IN   - Input graph (GML, binary or edge list format)\n");
 	printf("  SIZE       - Size of the motifs to consider\n");
-	printf("  MOTIF_ID   - The isomorphic class of the motif\n");
+	printf("  MOTIF_ID   - The isomorphic class of the motif, or a file holding the motif graph\n");
 	printf("  OUT_PREFIX - Prefix to output all clustering type and nodes files (Optional)\n");
+	printf("  --undirected - Read an edge list as an undirected graph (default directed)\n");
+	printf("  --threads N  - Number of threads classifying the pairs of motifs (default 1)\n");
+	printf("  --pairs FILE - Stream the pairs of motifs sharing a vertex and their types to FILE (CSV)\n");
+	printf("  --pairs-binary FILE - As --pairs with records of three 64-bit integers\n");
+	printf("  --metrics FILE - Write a JSON report of times, counters and peak memory to FILE\n");
 }
 
 /* ---------------------------------------------------------------------------------------------- */